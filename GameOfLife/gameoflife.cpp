@@ -11,12 +11,18 @@
 #include <fstream>
 #include <sstream>
 #include <string>
-#include <vector>
 #include <random>
+#include <chrono>
 
 #include <Windows.h>
 #include <tchar.h>
 
+#include "glmap.h"
+#include "glworker.h"
+#include "glpattern.h"
+#include "glsnapshot.h"
+#include "glrender.h"
+
 
 #define GETXLPARAM(l)   (MAKEPOINTS(l).x)
 #define GETYLPARAM(l)   (MAKEPOINTS(l).y)
@@ -28,13 +34,7 @@
 #define WM_GLSETSCROLL  (WM_APP + 4)    /* wparam is a BOOL indicating if redraw */
 #define WM_GLSETTEXT    (WM_APP + 5)
 #define WM_GLHELP       (WM_APP + 6)
-
-#define GL_BIRTHCNT     3
-#define GL_ALIVECNT     2
-
-#define GLM_DEFMAPW     100
-#define GLM_DEFMAPH     100
-#define GLM_DEFRATIO    0.25
+#define WM_GLSNAPSHOT   (WM_APP + 7)
 
 #define GLWC_CLSNAME    "GAMEOFLIFE"
 #define GLWC_EXSIZE     sizeof(LONG_PTR)
@@ -44,9 +44,12 @@
 #define GLRT_SF_INSERT  0x02
 #define GLRT_SF_INFMAP  0x04
 #define GLRT_SF_HELP    0x08
+#define GLRT_SF_BOUNDS  0x10
 #define GLRTISFROZEN(s) ((s) & (GLRT_SF_PAUSE | GLRT_SF_INSERT))
 
 #define GLRT_TIMERID    1
+#define GLRT_FRAMETIME  16      /* ms between two polls for a new frame of the worker */
+#define GLRT_RATEPERIOD 500     /* ms between two measurements of the generation rate */
 
 #define GLW_MINWNDW     400
 #define GLW_MINWNDH     400
@@ -54,7 +57,9 @@
 #define GLW_DEFSCALE    5
 #define GLW_MINSCALE    1
 #define GLW_MAXSCALE    10
+#define GLW_MAXSHRINK   10      /* zoomed out to 2^10 x 2^10 cells per pixel */
 #define GLW_SCROLLPAGE  10
+#define GLW_SNAPNAME    "gameoflife-"   /* followed by the generation and .gls */
 #define GLW_ZOOMDELTA   3
 
 #define GLW_CHAR_ESC    '\x1B'
@@ -68,17 +73,17 @@
 #define GLW_CHAR_DEC    'a'
 #define GLW_CHAR_NEXT   'n'
 #define GLW_CHAR_HELP   'h'
+#define GLW_CHAR_BOUNDS 'b'
+#define GLW_CHAR_SNAP   'k'
+#define GLW_CHAR_REWIND 'r'
 
 #define GLW_COLBLANK    RGB(0, 0, 0)
 #define GLW_COLCELL     RGB(255, 255, 255)
 #define GLW_COLBARRIER  RGB(255, 255, 0)
 #define GLW_COLBORDER   RGB(0, 0, 255)
+#define GLW_COLBOUNDS   RGB(255, 0, 0)
 #define GLW_DEFCOLTBG   RGB(0, 255, 255)
-
-#define GLDT_RATIO      0
-#define GLDT_BITMAP     1
-#define GLDT_COORD      2
-#define GLDT_RECT       3
+#define GLW_PIXEL(c)    ((uint32_t(GetRValue(c)) << 16) | (uint32_t(GetGValue(c)) << 8) | GetBValue(c))
 
 #define GLSTR_WNDHELP   "\
  ESC\texit \n\
@@ -91,6 +96,9 @@
  i\tinsert mode \n\
  n\tnext step \n\
  e\ttoggle edge \n\
+ b\tbounding box \n\
+ k\tsave snapshot \n\
+ r\trewind a step \n\
  BS\tclear map \n\
  LMB\tspawn cell \n\
  RMB\tkill cell \
@@ -107,11 +115,11 @@ using tstring = std::basic_string<TCHAR>;
 using tstringstream = std::basic_stringstream<TCHAR>;
 
 class Speed {
-    static const int _count = 8;
+    static const int _count = 9;
     static const struct _Val { int interval; int rps; LPCTSTR description; } _vlist[_count];
 
 public:
-    enum Option :int { MANUAL, EXSLOW, VSLOW, SLOW, NORMAL, FAST, VFAST, EXFAST };
+    enum Option :int { MANUAL, EXSLOW, VSLOW, SLOW, NORMAL, FAST, VFAST, EXFAST, MAX };
 
     Speed() :_opt(NORMAL) {}
     Speed(const Option opt) { _assign(opt); }
@@ -151,105 +159,13 @@ const Speed::_Val Speed::_vlist[Speed::_count] = {
     { 50, 20, TEXT("Fast") },
     { 25, 40, TEXT("Very Fast") },
     { 10, 100, TEXT("Extremly Fast") },
+    { 0, 0, TEXT("Maximum") },      //as many rounds as the worker can run
 };
 
-class GLMap {
-public:
-    LPCTSTR name = TEXT(GLW_WNDNAME);
-
-    GLMap(size_t width, size_t height) :_width(width), _height(height), _gen(0) { _alloc(); }
-    GLMap(const GLMap&) = delete;
-    GLMap(GLMap&&) = delete;
-    ~GLMap() { _free(); }
-
-    bool* operator[](size_t row) { return _mfront + row * _width; }
-
-    size_t width() const { return _width; }
-    size_t height() const { return _height; }
-    size_t gen() const { return _gen; }
-    bool valid(size_t x, size_t y) const { return (x < _width && y < _height); }
-
-    void init();
-    void init(float ratio, unsigned seed = std::minstd_rand::default_seed);
-    void init(const bool map[], size_t size);
-    void init(const POINT coord[], size_t size);
-    void init(const RECT rect[], size_t size);
-    void next(bool boundless = false);
-
-private:
-    size_t _width, _height, _gen;
-    bool* _mfront, * _mback;
-
-    void _alloc() { _mfront = new bool[_width * _height]; _mback = new bool[_width * _height]; }
-    void _free() { delete[] _mfront; delete[] _mback; }
-    size_t _offset(size_t x, size_t y) const { return (x + _width) % _width + (y + _height) % _height * _width; }
-};
-
-void GLMap::init() {
-    _gen = 0;
-    memset(_mfront, 0, sizeof(bool) * _width * _height);
-}
-
-void GLMap::init(float ratio, unsigned seed /*std::minstd_rand::default_seed*/) {
-    size_t msize = _width * _height;
-    size_t csize = std::min(size_t(msize * std::abs(ratio)), msize);
-    init();
-    memset(_mfront, 1, sizeof(bool) * csize);
-    if (csize > 0 && csize < msize) {
-        std::minstd_rand urand(seed);
-        for (size_t i = 0; i < msize; i++) {    //shuffle
-            size_t k = urand() % (msize - i) + i;
-            std::swap(_mfront[i], _mfront[k]);
-        }
-    }
-}
-
-void GLMap::init(const bool map[], size_t size) {
-    init();
-    memcpy(_mfront, map, sizeof(bool) * std::min(size, _width * _height));
-}
-
-void GLMap::init(const POINT coord[], size_t size) {
-    init();
-    for (size_t i = 0; i < size; i++) {
-        auto& pt = coord[i];
-        if (valid(pt.x, pt.y)) _mfront[pt.x + pt.y * _width] = true;
-    }
-}
-
-void GLMap::init(const RECT rect[], size_t size) {
-    init();
-    for (size_t i = 0; i < size; i++) {
-        RECT reg = { 0, 0, (LONG)_width, (LONG)_height };
-        IntersectRect(&reg, &reg, &rect[i]);
-        for (LONG row = reg.top; row < reg.bottom; row++) {
-            memset(&_mfront[row * _width + reg.left], 1, sizeof(bool) * (reg.right - reg.left));
-        }
-    }
-}
-
-void GLMap::next(bool boundless /*flase*/) {
-    for (size_t i = 0; i < _width * _height; i++) {
-        size_t x = i % _width, y = i / _width, cnt = 0;
-
-        cnt += (boundless || valid(x - 1, y - 1)) && _mfront[_offset(x - 1, y - 1)];
-        cnt += (boundless || valid(x, y - 1)) && _mfront[_offset(x, y - 1)];
-        cnt += (boundless || valid(x + 1, y - 1)) && _mfront[_offset(x + 1, y - 1)];
-        cnt += (boundless || valid(x - 1, y)) && _mfront[_offset(x - 1, y)];
-        cnt += (boundless || valid(x + 1, y)) && _mfront[_offset(x + 1, y)];
-        cnt += (boundless || valid(x - 1, y + 1)) && _mfront[_offset(x - 1, y + 1)];
-        cnt += (boundless || valid(x, y + 1)) && _mfront[_offset(x, y + 1)];
-        cnt += (boundless || valid(x + 1, y + 1)) && _mfront[_offset(x + 1, y + 1)];
-
-        _mback[i] = (cnt == GL_BIRTHCNT) + (cnt == GL_ALIVECNT) * _mfront[i];
-    }
-    std::swap(_mfront, _mback);
-    _gen++;
-}
-
 struct GLRuntime {
-    GLMap* map = nullptr;
+    GLMap* map = nullptr;       //owned by the worker while the window exists
     BYTE scale = GLW_DEFSCALE;
+    BYTE shrink = 0;            //zoomed out, 2^shrink x 2^shrink cells per pixel with a scale of 1
     BYTE state = GLRT_SF_PAUSE | GLRT_SF_HELP;
     Speed speed = Speed::NORMAL;
     POINT target = { -1 , -1 };
@@ -257,14 +173,25 @@ struct GLRuntime {
     COLORREF col_cell = GLW_COLCELL;
     COLORREF col_barrier = GLW_COLBARRIER;
     COLORREF col_border = GLW_COLBORDER;
-
-    LONG width() const { return (map) ? ((LONG)map->width() + 2) * scale : 0; }
-    LONG height() const { return (map) ? ((LONG)map->height() + 2) * scale : 0; }
-    LONG mapoff(LONG wndpos, LONG offset) const { return (wndpos - offset) / scale - 1; }
-    LONG wndpos(LONG mapoff, LONG offset) const { return (mapoff + 1) * scale + offset; }
+    COLORREF col_bounds = GLW_COLBOUNDS;
+    size_t rate_gen = 0;        //generation and tick of the last rate measurement
+    DWORD rate_tick = 0;
+    double gps = 0;
+    GLWorker* worker = nullptr;
+    GLCanvas canvas;            //the client area, kept between paints
+
+    LONG width() const { return (map) ? (blocks(map->width()) + 2) * scale : 0; }
+    LONG height() const { return (map) ? (blocks(map->height()) + 2) * scale : 0; }
+    LONG blocks(size_t cells) const { return LONG((cells + (size_t(1) << shrink) - 1) >> shrink); }
+    LONG mapoff(LONG wndpos, LONG offset) const { return ((wndpos - offset) / scale - 1) * (1L << shrink); }
+    LONG wndpos(LONG mapoff, LONG offset) const { return ((mapoff >> shrink) + 1) * scale + offset; }
+    int zoom() const { return scale - shrink; }     //1 - shrink when zoomed out
+    double ppc() const { return double(scale) / (1L << shrink); }   //pixels per cell
 
     POINT offset(HWND hwnd) const;
-    void draw(HDC hdc, RECT region, POINT offset) const;
+    void draw(HDC hdc, RECT client, POINT offset);
+    void measure(bool restart = false);
+    void pace() const { worker->pace((GLRTISFROZEN(state)) ? GLWK_PAUSED : speed.interval()); }
 };
 
 POINT GLRuntime::offset(HWND hwnd) const {
@@ -285,31 +212,65 @@ POINT GLRuntime::offset(HWND hwnd) const {
     return pt;
 }
 
-void GLRuntime::draw(HDC hdc, RECT region, POINT offset) const {
-    HBRUSH hbr = (HBRUSH)GetStockObject(DC_BRUSH);
-    COLORREF col_edge = (state & GLRT_SF_INFMAP) ? col_border : col_barrier;
+void GLRuntime::measure(bool restart) {
+    DWORD tick = GetTickCount();
+    size_t gen = worker->frame().gen;
+    if (restart || gen < rate_gen) {
+        gps = 0;
+    } else if (tick - rate_tick >= GLRT_RATEPERIOD) {
+        gps = (gen - rate_gen) * 1000.0 / (tick - rate_tick);
+    } else {
+        return;
+    }
+    rate_gen = gen;
+    rate_tick = tick;
+}
 
-    RECT visual, content = { 0, 0, width(), height() };
-    OffsetRect(&content, offset.x, offset.y);
-
-    IntersectRect(&visual, &content, &region);
-    SetDCBrushColor(hdc, col_edge);
-    FillRect(hdc, &visual, hbr);
-
-    InflateRect(&content, -scale, -scale);
-    IntersectRect(&visual, &content, &region);
-    SetDCBrushColor(hdc, col_blank);
-    FillRect(hdc, &visual, hbr);
-
-    SetDCBrushColor(hdc, col_cell);
-    for (size_t i = 0; map && i < map->width() * map->height(); i++) {
-        LONG x = LONG(i % map->width()), y = LONG(i / map->width());
-        RECT cell = { 0, 0, scale, scale };
-        OffsetRect(&cell, wndpos(x, offset.x), wndpos(y, offset.y));
-        if ((*map)[y][x] && IntersectRect(&visual, &cell, &region)) {
-            FillRect(hdc, &visual, hbr);
+/* only the cells inside the client area are visited, and only those that changed
+ * since the last paint are drawn again, then the canvas is copied in one call,
+ * clipped to the update region by the paint DC,
+ * the worker is told the cells in view, and publishes only those from then on,
+ * or only the mipmap when zoomed out, until a frame holds the new view, the cells
+ * are read from the map itself between two generations
+ */
+void GLRuntime::draw(HDC hdc, RECT client, POINT offset) {
+    canvas.resize(client.right, client.bottom);
+    COLORREF col_edge = (state & GLRT_SF_INFMAP) ? col_border : col_barrier;
+    GLPalette palette = { GLW_PIXEL(col_blank), GLW_PIXEL(col_cell), GLW_PIXEL(col_edge), GLW_PIXEL(col_bounds) };
+
+    if (worker && shrink) {
+        worker->view({});
+        const GLFrame& frame = worker->frame();
+        bool bounds = (state & GLRT_SF_BOUNDS) && frame.stats.population;
+        canvas.render(frame.mipmap, offset.x, offset.y, shrink, palette, (bounds) ? &frame.stats.bbox : nullptr);
+    } else if (worker) {
+        const GLFrame& frame = worker->frame();
+        GLRect view = canvas.visible(frame.width, frame.height, offset.x, offset.y, scale);
+        worker->view(view);
+        if (frame.covers(view)) {
+            auto rows = [&frame](size_t y, size_t x) { return frame.row(y, x); };
+            bool bounds = (state & GLRT_SF_BOUNDS) && frame.stats.population;
+            canvas.render(frame.width, frame.height, rows, offset.x, offset.y, scale, palette, (bounds) ? &frame.stats.bbox : nullptr);
+        } else {
+            worker->readMap([&](const GLMap& map) {
+                auto rows = [&map](size_t y, size_t x) { return (const char*)map[y] + x; };
+                bool bounds = (state & GLRT_SF_BOUNDS) && map.stats().population;
+                canvas.render(map.width(), map.height(), rows, offset.x, offset.y, scale, palette, (bounds) ? &map.stats().bbox : nullptr);
+            });
         }
+    } else {
+        auto rows = [](size_t, size_t) { return (const char*)nullptr; };
+        canvas.render(0, 0, rows, offset.x, offset.y, scale, palette);
     }
+
+    BITMAPINFO bmi = {};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = (LONG)canvas.width();
+    bmi.bmiHeader.biHeight = -(LONG)canvas.height();    //top-down rows
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    SetDIBitsToDevice(hdc, 0, 0, client.right, client.bottom, 0, 0, 0, client.bottom, canvas.pixels(), &bmi, DIB_RGB_COLORS);
 }
 
 
@@ -329,8 +290,9 @@ LRESULT onCreate(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     SetScrollInfo(hwnd, SB_HORZ, &sci, FALSE);
     SetScrollInfo(hwnd, SB_VERT, &sci, FALSE);
 
-    if (!GLRTISFROZEN(pgl->state) && pgl->speed != Speed::MANUAL)
-        SetTimer(hwnd, GLRT_TIMERID, pgl->speed.interval(), nullptr);
+    pgl->worker->boundless(pgl->state & GLRT_SF_INFMAP);
+    pgl->pace();
+    SetTimer(hwnd, GLRT_TIMERID, GLRT_FRAMETIME, nullptr);
 
     PostMessage(hwnd, WM_GLSETTEXT, 0, 0);
     return 0;
@@ -346,12 +308,11 @@ LRESULT onGLPause(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     GLRuntime* pgl = (GLRuntime*)GetWindowLongPtr(hwnd, GLWC_EXOFFSET);
     if (GLRTISFROZEN(pgl->state)) { //resume
         pgl->state &= ~(GLRT_SF_PAUSE | GLRT_SF_INSERT);
-        if (pgl->speed != Speed::MANUAL)
-            SetTimer(hwnd, GLRT_TIMERID, pgl->speed.interval(), nullptr);
+        pgl->measure(true);
     } else {    //pause
         pgl->state |= GLRT_SF_PAUSE;
-        KillTimer(hwnd, GLRT_TIMERID);
     }
+    pgl->pace();
     PostMessage(hwnd, WM_GLSETTEXT, 0, 0);
     return 0;
 }
@@ -359,11 +320,10 @@ LRESULT onGLPause(HWND hwnd, WPARAM wparam, LPARAM lparam) {
 LRESULT onGLInsert(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     GLRuntime* pgl = (GLRuntime*)GetWindowLongPtr(hwnd, GLWC_EXOFFSET);
     pgl->state ^= GLRT_SF_INSERT;
-    if (pgl->state & GLRT_SF_INSERT) {  //enter insert mode
-        KillTimer(hwnd, GLRT_TIMERID);
-    } else {    //exit insert mode and keep pause
+    if (!(pgl->state & GLRT_SF_INSERT)) {   //exit insert mode and keep pause
         pgl->state |= GLRT_SF_PAUSE;
     }
+    pgl->pace();
     PostMessage(hwnd, WM_GLSETTEXT, 0, 0);
     return 0;
 }
@@ -371,11 +331,8 @@ LRESULT onGLInsert(HWND hwnd, WPARAM wparam, LPARAM lparam) {
 LRESULT onGLSpeed(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     GLRuntime* pgl = (GLRuntime*)GetWindowLongPtr(hwnd, GLWC_EXOFFSET);
     pgl->speed += (int)wparam;
-    if (pgl->speed == Speed::MANUAL) {
-        KillTimer(hwnd, GLRT_TIMERID);
-    } else if (!GLRTISFROZEN(pgl->state)) {
-        SetTimer(hwnd, GLRT_TIMERID, pgl->speed.interval(), nullptr);
-    }
+    pgl->measure(true);
+    pgl->pace();
     PostMessage(hwnd, WM_GLSETTEXT, 0, 0);
     return 0;
 }
@@ -393,17 +350,21 @@ LRESULT onGLZoom(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     npos.y = sci.nPos - std::max(origin.y, 0L);
 
     //zoom and update scroll bar
-    BYTE scale = std::min(std::max(pgl->scale + (int)wparam, GLW_MINSCALE), GLW_MAXSCALE);
-    std::swap(pgl->scale, scale);
+    //below one pixel per cell, every step halves the pixels per cell
+    double ppc = pgl->ppc();
+    int zoom = std::min(std::max(pgl->zoom() + (int)wparam, GLW_MINSCALE - GLW_MAXSHRINK), GLW_MAXSCALE);
+    pgl->scale = (BYTE)std::max(zoom, GLW_MINSCALE);
+    pgl->shrink = (BYTE)std::max(GLW_MINSCALE - zoom, 0);
+    pgl->worker->mipmap(pgl->shrink > 0);
     SendMessage(hwnd, WM_GLSETSCROLL, FALSE, 0);
 
     //update scroll position
     POINTS mpos = MAKEPOINTS(lparam);
     sci.fMask = SIF_RANGE;  //PAGE is alternative, see onGLSetScroll()
     GetScrollInfo(hwnd, SB_HORZ, &sci); //NOTE: Get before any Set, otherwise it may get wrong data
-    npos.x = ((npos.x + mpos.x) * pgl->scale / scale - mpos.x) * (bool)sci.nMax;
+    npos.x = LONG((npos.x + mpos.x) * pgl->ppc() / ppc - mpos.x) * (bool)sci.nMax;
     GetScrollInfo(hwnd, SB_VERT, &sci);
-    npos.y = ((npos.y + mpos.y) * pgl->scale / scale - mpos.y) * (bool)sci.nMax;
+    npos.y = LONG((npos.y + mpos.y) * pgl->ppc() / ppc - mpos.y) * (bool)sci.nMax;
 
     sci.fMask = SIF_POS;
     sci.nPos = npos.x;
@@ -443,8 +404,10 @@ LRESULT onGLSetText(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     GLRuntime* pgl = (GLRuntime*)GetWindowLongPtr(hwnd, GLWC_EXOFFSET);
     tstringstream text;
 
-    text << pgl->map->name << TEXT(':') << TEXT("  ");
-    text << pgl->map->gen() << TEXT("  ");
+    text << TEXT(GLW_WNDNAME) << TEXT(':') << TEXT("  ");
+    text << pgl->worker->frame().gen << TEXT("  ");
+    if (!pgl->map->rule().conway())
+        text << ruleString(pgl->map->rule()).c_str() << TEXT("  ");
 
     if (pgl->state & GLRT_SF_INSERT) {
         text << TEXT("Insert") << TEXT("  ");
@@ -453,10 +416,25 @@ LRESULT onGLSetText(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     }
 
     text << pgl->speed.description();
-    if (pgl->speed != Speed::MANUAL)
+    if (pgl->speed != Speed::MANUAL && pgl->speed != Speed::MAX)
         text << TEXT('[') << pgl->speed.rps() << TEXT(" RPS") << TEXT(']');
     text << TEXT("  ");
 
+    if (!GLRTISFROZEN(pgl->state) && pgl->speed != Speed::MANUAL)
+        text << (size_t)pgl->gps << TEXT(" gen/s") << TEXT("  ");
+
+    const GLStats& stats = pgl->worker->frame().stats;
+    text << TEXT("Pop ") << stats.population << TEXT(" (+") << stats.births << TEXT(" -") << stats.deaths << TEXT(')') << TEXT("  ");
+
+    if (pgl->worker->frame().period)
+        text << TEXT("Period ") << pgl->worker->frame().period << TEXT("  ");
+
+    const GLRect& bbox = stats.bbox;
+    if ((pgl->state & GLRT_SF_BOUNDS) && stats.population) {
+        text << TEXT('[') << bbox.left << TEXT(',') << bbox.top << TEXT(" - ");
+        text << bbox.right - 1 << TEXT(',') << bbox.bottom - 1 << TEXT(']') << TEXT("  ");
+    }
+
     if (pgl->map->valid(pgl->target.x, pgl->target.y))
         text << TEXT('(') << pgl->target.x << TEXT(',') << pgl->target.y << TEXT(')');
 
@@ -489,9 +467,7 @@ LRESULT onChar(HWND hwnd, WPARAM wparam, LPARAM lparam) {
         break;
     case TEXT(GLW_CHAR_BS):     //clear the whole map
         if (pgl->state & GLRT_SF_INSERT) {
-            pgl->map->init();
-            PostMessage(hwnd, WM_GLSETTEXT, 0, 0);
-            InvalidateRect(hwnd, nullptr, FALSE);
+            pgl->worker->clear();   //repainted when the worker publishes the frame
         }
         break;
     case TEXT(GLW_CHAR_ZIN):    //zoom in
@@ -508,7 +484,7 @@ LRESULT onChar(HWND hwnd, WPARAM wparam, LPARAM lparam) {
         break;
     case TEXT(GLW_CHAR_NEXT):   //next round when manual
         if (!GLRTISFROZEN(pgl->state) && pgl->speed == Speed::MANUAL) {
-            SendMessage(hwnd, WM_TIMER, GLRT_TIMERID, (LPARAM)NULL);
+            pgl->worker->step(1);
         }
         break;
     case TEXT(GLW_CHAR_HELP):   //show or hide help information
@@ -517,9 +493,23 @@ LRESULT onChar(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     case TEXT(GLW_CHAR_EDGE):   //change map type
         if (GLRTISFROZEN(pgl->state)) {
             pgl->state ^= GLRT_SF_INFMAP;
+            pgl->worker->boundless(pgl->state & GLRT_SF_INFMAP);
             InvalidateRect(hwnd, nullptr, FALSE);
         }
         break;
+    case TEXT(GLW_CHAR_BOUNDS): //show or hide the bounding box of alive cells
+        pgl->state ^= GLRT_SF_BOUNDS;
+        PostMessage(hwnd, WM_GLSETTEXT, 0, 0);
+        InvalidateRect(hwnd, nullptr, FALSE);
+        break;
+    case TEXT(GLW_CHAR_SNAP):   //save the map to a snapshot file
+        PostMessage(hwnd, WM_GLSNAPSHOT, 0, 0);
+        break;
+    case TEXT(GLW_CHAR_REWIND): //back to the previous generation when frozen
+        if (GLRTISFROZEN(pgl->state)) {
+            pgl->worker->rewind(1); //repainted when the worker publishes the frame
+        }
+        break;
     }
     return 0;
 }
@@ -530,10 +520,7 @@ LRESULT onLRButtonDown(HWND hwnd, WPARAM wparam, LPARAM lparam, bool lbutton) {
         POINT origin = pgl->offset(hwnd);
         pgl->target = { pgl->mapoff(GETXLPARAM(lparam), origin.x), pgl->mapoff(GETYLPARAM(lparam), origin.y) };
         if (pgl->map->valid(pgl->target.x, pgl->target.y)) {
-            RECT uprect = { 0, 0, pgl->scale, pgl->scale };
-            (*pgl->map)[pgl->target.y][pgl->target.x] = lbutton;
-            OffsetRect(&uprect, pgl->wndpos(pgl->target.x, origin.x), pgl->wndpos(pgl->target.y, origin.y));
-            InvalidateRect(hwnd, &uprect, FALSE);
+            pgl->worker->edit(pgl->target.x, pgl->target.y, lbutton);
         }
     }
     return 0;
@@ -546,16 +533,29 @@ LRESULT onMouseMove(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     if ((pgl->state & GLRT_SF_INSERT) && (wparam == MK_LBUTTON || wparam == MK_RBUTTON)) {
         bool alive = wparam & MK_LBUTTON;
         if (pgl->map->valid(pgl->target.x, pgl->target.y)) {
-            RECT uprect = { 0, 0, pgl->scale, pgl->scale };
-            (*pgl->map)[pgl->target.y][pgl->target.x] = alive;
-            OffsetRect(&uprect, pgl->wndpos(pgl->target.x, origin.x), pgl->wndpos(pgl->target.y, origin.y));
-            InvalidateRect(hwnd, &uprect, FALSE);
+            pgl->worker->edit(pgl->target.x, pgl->target.y, alive);
         }
     }
     SendMessage(hwnd, WM_GLSETTEXT, 0, 0);
     return 0;
 }
 
+/* the map as the worker holds it, as the frames only hold the cells in view */
+LRESULT onGLSnapshot(HWND hwnd, WPARAM wparam, LPARAM lparam) {
+    GLRuntime* pgl = (GLRuntime*)GetWindowLongPtr(hwnd, GLWC_EXOFFSET);
+    tstringstream fname;
+    bool saved = false;
+    pgl->worker->readMap([&](const GLMap& map) {
+        fname << TEXT(GLW_SNAPNAME) << map.gen() << TEXT(".gls");
+        std::ofstream file(fname.str().c_str(), std::ios::binary);
+        saved = file.is_open() && saveSnapshot(file, map, pgl->state & GLRT_SF_INFMAP);
+    });
+
+    tstring text = ((saved) ? TEXT("Saved to ") : TEXT("Unable to save ")) + fname.str();
+    MessageBox(hwnd, text.c_str(), TEXT(GLW_WNDNAME), MB_OK | ((saved) ? MB_ICONINFORMATION : MB_ICONERROR));
+    return 0;
+}
+
 LRESULT onScroll(HWND hwnd, WPARAM wparam, LPARAM lparam, bool hscroll) {
     GLRuntime* pgl = (GLRuntime*)GetWindowLongPtr(hwnd, GLWC_EXOFFSET);
     SCROLLINFO sci = { sizeof(SCROLLINFO) };
@@ -616,6 +616,7 @@ LRESULT onSize(HWND hwnd, WPARAM wparam, LPARAM lparam) {
         break;
     case SIZE_MINIMIZED:
         pgl->state |= GLRT_SF_PAUSE;
+        pgl->pace();
         break;
     }
     return 0;
@@ -644,50 +645,33 @@ LRESULT onPaint(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     PAINTSTRUCT ps;
     HDC hdc = BeginPaint(hwnd, &ps);
 
+    //decide the map position and draw map
     RECT crect;
     GetClientRect(hwnd, &crect);
-    HDC hdcbuffer = CreateCompatibleDC(hdc);
-    HBITMAP hbmbuffer = CreateCompatibleBitmap(hdc, crect.right, crect.bottom);
-    SelectObject(hdcbuffer, hbmbuffer);
+    pgl->draw(hdc, crect, pgl->offset(hwnd));
 
-    //paint the background
-    HBRUSH hbr = (HBRUSH)GetStockObject(DC_BRUSH);
-    SetDCBrushColor(hdcbuffer, GLW_COLBLANK);
-    FillRect(hdcbuffer, &crect, hbr);
-
-    //decide the map position and draw map
-    pgl->draw(hdcbuffer, ps.rcPaint, pgl->offset(hwnd));
-
-    //draw help information
+    //draw help information over the map
     if (pgl->state & GLRT_SF_HELP) {
         RECT trect = {};
-        SetBkColor(hdcbuffer, GLW_DEFCOLTBG);
-        SetDCBrushColor(hdcbuffer, GLW_DEFCOLTBG);
-        DrawText(hdcbuffer, TEXT(GLSTR_WNDHELP), -1, &trect, DT_CALCRECT | DT_EXPANDTABS);
-        FillRect(hdcbuffer, &trect, hbr);
-        DrawText(hdcbuffer, TEXT(GLSTR_WNDHELP), -1, &trect, DT_EXPANDTABS);
+        HBRUSH hbr = (HBRUSH)GetStockObject(DC_BRUSH);
+        SetBkColor(hdc, GLW_DEFCOLTBG);
+        SetDCBrushColor(hdc, GLW_DEFCOLTBG);
+        DrawText(hdc, TEXT(GLSTR_WNDHELP), -1, &trect, DT_CALCRECT | DT_EXPANDTABS);
+        FillRect(hdc, &trect, hbr);
+        DrawText(hdc, TEXT(GLSTR_WNDHELP), -1, &trect, DT_EXPANDTABS);
     }
 
-    BitBlt(
-        hdc,
-        ps.rcPaint.left, ps.rcPaint.top,
-        ps.rcPaint.right - ps.rcPaint.left, ps.rcPaint.bottom - ps.rcPaint.top,
-        hdcbuffer,
-        ps.rcPaint.left, ps.rcPaint.top,
-        SRCCOPY
-    );
-
-    DeleteObject(hdcbuffer);
-    DeleteObject(hbmbuffer);
     EndPaint(hwnd, &ps);
     return 0;
 }
 
 LRESULT onTimer(HWND hwnd, WPARAM wparam, LPARAM lparam) {
     GLRuntime* pgl = (GLRuntime*)GetWindowLongPtr(hwnd, GLWC_EXOFFSET);
-    pgl->map->next(pgl->state & GLRT_SF_INFMAP);
-    PostMessage(hwnd, WM_GLSETTEXT, 0, 0);
-    InvalidateRect(hwnd, nullptr, FALSE);
+    if (pgl->worker->update()) {    //the latest frame, never waiting for the worker
+        pgl->measure();
+        PostMessage(hwnd, WM_GLSETTEXT, 0, 0);
+        InvalidateRect(hwnd, nullptr, FALSE);
+    }
     return 0;
 }
 
@@ -711,6 +695,8 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
         return onGLSetText(hwnd, wparam, lparam);
     case WM_GLHELP:
         return onGLHelp(hwnd, wparam, lparam);
+    case WM_GLSNAPSHOT:
+        return onGLSnapshot(hwnd, wparam, lparam);
     case WM_CHAR:
         return onChar(hwnd, wparam, lparam);
     case WM_MOUSEMOVE:
@@ -738,6 +724,11 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 }
 
 int runGame(GLRuntime* pRuntime, HINSTANCE hInstance, int nCmdShow) {
+    pRuntime->map->tally(true);     //the title and the bounds follow the statistics of the frames
+    GLHistory history;
+    GLWorker worker(*pRuntime->map, &history);
+    pRuntime->worker = &worker;
+
     HWND hwnd = CreateWindow(
         TEXT(GLWC_CLSNAME),
         TEXT(GLW_WNDNAME),
@@ -762,53 +753,27 @@ int runGame(GLRuntime* pRuntime, HINSTANCE hInstance, int nCmdShow) {
 }
 
 
-bool initFromStream(GLMap& map, std::istream& data, int dtype) {
-    switch (dtype) {
-    case GLDT_RATIO: {  //ratio
-        float ratio = 0;
-        data >> ratio;
-        map.init(ratio, std::random_device{}());
-        return true;
-    }
-    case GLDT_BITMAP: { //0 1 1 0 1 ...
-        std::vector<char> bitmap;   //std::vector<bool> is not an array
-        bool cell;
-        while (data >> cell) bitmap.push_back(cell);
-        map.init((bool*)bitmap.data(), bitmap.size());
-        return true;
-    }
-    case GLDT_COORD: {  //x y x y ...
-        std::vector<POINT> coord;
-        POINT pt;
-        while (data >> pt.x >> pt.y) coord.push_back(pt);
-        map.init(coord.data(), coord.size());
-        return true;
-    }
-    case GLDT_RECT: {   //left top right bottom ...
-        std::vector<RECT> rect;
-        RECT rc;
-        while (data >> rc.left >> rc.top >> rc.right >> rc.bottom) rect.push_back(rc);
-        map.init(rect.data(), rect.size());
-        return true;
-    }
-    }
-    return false;
-}
-
 int fromCmdLine(LPTSTR lpCmdLine, HINSTANCE hInstance, int nCmdShow) {
     tstring cmdl(lpCmdLine);
     if (cmdl.empty()) { //empty cmdl
         GLMap map(GLM_DEFMAPW, GLM_DEFMAPH);
+        map.tiles(true);
+        map.cycles(GLM_CYCLEFIND);
         GLRuntime runtime = { &map };
         map.init(GLM_DEFRATIO, std::random_device{}());
         return runGame(&runtime, hInstance, nCmdShow);
-    } else if (!cmdl.compare(0, 2, TEXT("-r"))) {   //cmdl: -r WIDTH HEIGHT SCALE RATIO
+    } else if (!cmdl.compare(0, 2, TEXT("-r"))) {   //cmdl: -r WIDTH HEIGHT SCALE RATIO [RULE]
         tstringstream data(cmdl.substr(2));
         int width, height, scale;
         float ratio;
-        if (data >> width >> height >> scale >> ratio) {
+        tstring rstr;
+        GLRule rule = GLR_CONWAY;
+        if (data >> width >> height >> scale >> ratio && (!(data >> rstr) || parseRule(rstr.c_str(), rule))) {
             if (width > 0 && height > 0) {
                 GLMap map(width, height);
+                map.tiles(true);
+                map.cycles(GLM_CYCLEFIND);
+                map.rule(rule);
                 GLRuntime runtime = { &map, (BYTE)std::min(std::max(scale, GLW_MINSCALE), GLW_MAXSCALE) };
                 map.init(ratio, std::random_device{}());
                 return runGame(&runtime, hInstance, nCmdShow);
@@ -817,18 +782,19 @@ int fromCmdLine(LPTSTR lpCmdLine, HINSTANCE hInstance, int nCmdShow) {
         return RETVAL_BADARGS;
     } else if (cmdl.find_first_of(TEXT(' ')) == cmdl.npos || cmdl.find_first_of(TEXT('"'), 1) == cmdl.size() - 1) { //cmdl: FILENAME
         tstring fname = (cmdl[0] == TEXT('"')) ? cmdl.substr(1, cmdl.size() - 2) : cmdl;    //remove quotes
-        std::ifstream file(fname.c_str());  //compatible with GCC
-        if (file.is_open()) {
-            int width, height, scale, dtype;
-            if (file >> width >> height >> scale >> dtype) {
-                if (width > 0 && height > 0) {
-                    GLMap map(width, height);
-                    GLRuntime runtime = { &map, (BYTE)std::min(std::max(scale, GLW_MINSCALE), GLW_MAXSCALE) };
-                    if (initFromStream(map, file, dtype)) {
-                        file.close();
-                        return runGame(&runtime, hInstance, nCmdShow);
-                    }
-                }
+        GLPattern pattern;
+        if (pattern.open(fname.c_str())) {
+            if (pattern.parse()) {
+                GLMap map(pattern.width(), pattern.height());
+                map.tiles(true);
+                map.cycles(GLM_CYCLEFIND);
+                map.rule(pattern.rule());
+                int scale = (pattern.scale() > 0) ? pattern.scale() : GLW_DEFSCALE; //only init files have a scale
+                GLRuntime runtime = { &map, (BYTE)std::min(std::max(scale, GLW_MINSCALE), GLW_MAXSCALE) };
+                if (pattern.boundless()) runtime.state |= GLRT_SF_INFMAP;
+                pattern.load(map, std::random_device{}());
+                pattern.close();
+                return runGame(&runtime, hInstance, nCmdShow);
             }
             return RETVAL_BADDATA;
         }
@@ -0,0 +1,694 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <array>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <chrono>
+#include <thread>
+#include <random>
+#include <stdexcept>
+#include <cstring>
+
+#include "glmap.h"
+#include "glbitmap.h"
+#include "glmipmap.h"
+#include "glrender.h"
+#include "glworker.h"
+
+
+#define RETVAL_EXIT     0
+#define RETVAL_CMDFAIL  1
+#define RETVAL_BADARGS  2
+#define RETVAL_ERROPEN  3
+#define RETVAL_BADDATA  4
+#define RETVAL_REGRESS  5
+#define RETVAL_MISMATCH 6
+
+constexpr auto DEF_SIZES = "100,1000,5000,20000";
+constexpr auto DEF_RATIOS = "0.1,0.3,0.5";
+constexpr double DEF_TIME = 0.5;
+constexpr double DEF_TOLERANCE = 10;
+constexpr long DEF_CANVASW = 1280;
+constexpr long DEF_CANVASH = 720;
+constexpr unsigned DEF_SEED = 1;
+constexpr size_t DEF_VERIFYGENS = 64;
+
+const char* const VERIFY_RULES[] = { "B3/S23", "B36/S23", "B3678/S34678", "B2/S", "B1357/S1357", "B0/S8" };
+const size_t VERIFY_SIZES[][2] = { { 1, 1 }, { 2, 3 }, { 7, 5 }, { 31, 17 }, { 33, 40 }, { 63, 64 }, { 65, 9 }, { 100, 37 }, { 129, 70 } };
+
+constexpr auto USAGE = "\
+glbench [-a <sizes>] [-c <file>] [-d <ratios>] [-f <prefix>] [-j <threads>] [-k <kernel>] [-l <layout>] [-o <file>] [-q <seconds>] [-s <seed>] [-t] [-v <width> <height>] [-x <percent>] [-y]\n\n\
+Optional arguments:\n\
+  -a, --sizes <sizes>   comma separated sides of the square maps (default 100,1000,5000,20000)\n\
+  -c, --compare <file>  compare the rates with a baseline written by -o, and flag the\n\
+                        cases slower by more than the tolerance as regressions\n\
+  -d, --ratios <ratios> comma separated densities of the random soups (default 0.1,0.3,0.5)\n\
+  -f, --filter <prefix> run only the cases whose name begins with <prefix>, e.g. next/soup\n\
+  -j, --jobs <threads>  comma separated numbers of threads stepping the maps\n\
+                        (default 1 and all cores)\n\
+  -k, --kernel <kernel> set the row kernel as <auto|scalar|sse2|avx2>,\n\
+                        <auto> the best one supported by the CPU (default)\n\
+  -l, --layout <layout> set the memory layout as <flat|padded> (default flat)\n\
+  -o, --output <file>   write the results to <file> as CSV, to be used as a baseline\n\
+  -q, --quota <seconds> least time spent on every case (default 0.5)\n\
+  -s, --seed <n>        seed of the random soups (default 1)\n\
+  -t, --tiles           skip the tiles that did not change\n\
+  -v, --canvas <width> <height>\n\
+                        size of the off-screen canvas of the drawing cases (default 1280 720)\n\
+  -x, --tolerance <percent>\n\
+                        slowdown allowed before a regression is flagged (default 10)\n\
+  -y, --verify          instead of timing, check every kernel and layout, with and\n\
+                        without tiles, on every number of threads of -j, against the\n\
+                        per-cell path, and exit with 6 on a difference\n\n\
+Cases:\n\
+  init/clear/<size>, init/soup/<size>/<ratio>/j<n>, init/coord/<size>\n\
+                        GLMap::init() clearing, filling a soup and placing a glider gun\n\
+  next/soup/<size>/<ratio>/<mode>/j<n>, next/<gun|rpent>/<size>/<mode>/j<n>\n\
+                        GLMap::next() on a soup, a Gosper glider gun or an R-pentomino,\n\
+                        in <bounded|boundless> mode, always the first generation\n\
+  draw/full/<size>, draw/diff/<size>\n\
+                        the window renderer painting a soup in full, or only the cells\n\
+                        changed by a generation, in frames per second\n\
+  draw/frame/<size>     the window painting the frames of a worker stepping the map,\n\
+                        which only hold the cells in view, so the rate does not\n\
+                        depend on the size of the map\n\
+  draw/mipmap/<size>, draw/zoom/<size>\n\
+                        updating the mipmap from the tiles changed by a generation, and\n\
+                        painting the whole map zoomed out to fit the canvas\n\
+  verify/<kernel>/<layout>/<flat|tiles>/j<n>\n\
+                        with -y, soups of several rules and sizes not multiple of the\n\
+                        vector widths, stepped in both modes with cells flipped halfway\n\
+";
+
+
+class ParseError : public std::logic_error {
+public:
+    using std::logic_error::logic_error;
+};
+
+struct Args {
+    std::vector<size_t> sizes;
+    std::vector<float> ratios;
+    std::vector<int> threads;
+    int kernel;
+    int layout;
+    bool tiles;
+    bool verify;
+    double quota;
+    unsigned seed;
+    long cwidth, cheight;
+    double tolerance;
+    std::string filter;
+    std::string output;
+    std::string baseline;
+} args_{};
+
+struct Result {
+    std::string name;
+    std::string unit;
+    double rate;        //units per second
+    double seconds;
+    size_t memory;      //bytes of the buffers
+};
+
+std::vector<Result> results_;
+std::map<std::string, double> baseline_;    //rates by case
+size_t regressions_ = 0;
+
+const GLPoint GUN[] = {
+    { 24, 0 }, { 22, 1 }, { 24, 1 }, { 12, 2 }, { 13, 2 }, { 20, 2 }, { 21, 2 }, { 34, 2 }, { 35, 2 },
+    { 11, 3 }, { 15, 3 }, { 20, 3 }, { 21, 3 }, { 34, 3 }, { 35, 3 }, { 0, 4 }, { 1, 4 }, { 10, 4 },
+    { 16, 4 }, { 20, 4 }, { 21, 4 }, { 0, 5 }, { 1, 5 }, { 10, 5 }, { 14, 5 }, { 16, 5 }, { 17, 5 },
+    { 22, 5 }, { 24, 5 }, { 10, 6 }, { 16, 6 }, { 24, 6 }, { 11, 7 }, { 15, 7 }, { 12, 8 }, { 13, 8 },
+};
+const GLPoint RPENT[] = { { 1, 0 }, { 2, 0 }, { 0, 1 }, { 1, 1 }, { 1, 2 } };
+const GLPalette PALETTE = { 0x000000, 0xFFFFFF, 0xFFFF00, 0xFF0000 };
+
+
+inline void assert(const bool condition, const std::string& message) {
+    if (!condition) throw ParseError(message);
+}
+
+template<class T>
+inline T argton(const char* str, const std::string& name) {
+    std::istringstream data(str);
+    T val;
+    assert(data >> val && data.peek() == EOF, "invalid value for " + name);
+    return val;
+}
+
+template<class T>
+inline std::vector<T> argtonlist(const char* str, const std::string& name) {
+    std::vector<T> vals;
+    std::istringstream list(str);
+    for (std::string val; std::getline(list, val, ',');) vals.push_back(argton<T>(val.c_str(), name));
+    assert(!vals.empty(), "invalid value for " + name);
+    return vals;
+}
+
+/* optional args:
+ * [-a <sizes>] [-c <file>] [-d <ratios>] [-f <prefix>] [-j <threads>] [-k <kernel>] [-l <layout>] [-o <file>] [-q <seconds>] [-s <seed>] [-t] [-v <width> <height>] [-x <percent>] [-y]
+ */
+int matchOptionalArgs(int argc, char* argv[], int idx, std::array<bool, 14>& parsed) {
+    if (!std::strcmp(argv[idx], "-a") || !std::strcmp(argv[idx], "--sizes")) {  //sides of the maps
+        assert(!parsed[0], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for sizes");
+
+        args_.sizes = argtonlist<size_t>(argv[idx + 1], "sizes");
+        for (size_t size : args_.sizes) assert(size > 0, "invalid value for sizes");
+
+        parsed[0] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-c") || !std::strcmp(argv[idx], "--compare")) {    //baseline to compare with
+        assert(!parsed[1], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified baseline file");
+
+        args_.baseline = argv[idx + 1];
+
+        parsed[1] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-d") || !std::strcmp(argv[idx], "--ratios")) { //densities of the soups
+        assert(!parsed[2], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for ratios");
+
+        args_.ratios = argtonlist<float>(argv[idx + 1], "ratios");
+
+        parsed[2] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-f") || !std::strcmp(argv[idx], "--filter")) { //cases to run
+        assert(!parsed[3], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified filter");
+
+        args_.filter = argv[idx + 1];
+
+        parsed[3] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-j") || !std::strcmp(argv[idx], "--jobs")) {   //numbers of threads
+        assert(!parsed[4], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for jobs");
+
+        args_.threads = argtonlist<int>(argv[idx + 1], "jobs");
+        for (int n : args_.threads) assert(n > 0, "invalid value for jobs");
+
+        parsed[4] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-k") || !std::strcmp(argv[idx], "--kernel")) { //row kernel
+        assert(!parsed[5], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified kernel");
+
+        if (!std::strcmp(argv[idx + 1], "auto")) args_.kernel = GLK_AVX2;
+        else if (!std::strcmp(argv[idx + 1], "scalar")) args_.kernel = GLK_SCALAR;
+        else if (!std::strcmp(argv[idx + 1], "sse2")) args_.kernel = GLK_SSE2;
+        else if (!std::strcmp(argv[idx + 1], "avx2")) args_.kernel = GLK_AVX2;
+        else throw ParseError("unknow kernel");
+
+        parsed[5] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-l") || !std::strcmp(argv[idx], "--layout")) { //memory layout
+        assert(!parsed[6], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified layout");
+
+        if (!std::strcmp(argv[idx + 1], "flat")) args_.layout = GLM_FLAT;
+        else if (!std::strcmp(argv[idx + 1], "padded")) args_.layout = GLM_PADDED;
+        else throw ParseError("unknow layout");
+
+        parsed[6] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-o") || !std::strcmp(argv[idx], "--output")) { //results as CSV
+        assert(!parsed[7], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified output file");
+
+        args_.output = argv[idx + 1];
+
+        parsed[7] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-q") || !std::strcmp(argv[idx], "--quota")) {  //time per case
+        assert(!parsed[8], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for quota");
+
+        args_.quota = argton<double>(argv[idx + 1], "quota");
+        assert(args_.quota >= 0, "invalid value for quota");
+
+        parsed[8] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-s") || !std::strcmp(argv[idx], "--seed")) {   //random seed
+        assert(!parsed[9], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for seed");
+
+        args_.seed = argton<unsigned>(argv[idx + 1], "seed");
+
+        parsed[9] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-t") || !std::strcmp(argv[idx], "--tiles")) {  //active tile tracking
+        assert(!parsed[10], "duplicate option: " + std::string(argv[idx]));
+
+        args_.tiles = true;
+
+        parsed[10] = true;
+        return 1;
+    } else if (!std::strcmp(argv[idx], "-v") || !std::strcmp(argv[idx], "--canvas")) { //off-screen canvas
+        assert(!parsed[11], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 2 < argc, "insufficient arguments for canvas");
+
+        args_.cwidth = argton<long>(argv[idx + 1], "width");
+        args_.cheight = argton<long>(argv[idx + 2], "height");
+        assert(args_.cwidth > 0 && args_.cheight > 0, "invalid canvas size");
+
+        parsed[11] = true;
+        return 3;
+    } else if (!std::strcmp(argv[idx], "-x") || !std::strcmp(argv[idx], "--tolerance")) {  //allowed slowdown
+        assert(!parsed[12], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for tolerance");
+
+        args_.tolerance = argton<double>(argv[idx + 1], "tolerance");
+        assert(args_.tolerance >= 0, "invalid value for tolerance");
+
+        parsed[12] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-y") || !std::strcmp(argv[idx], "--verify")) { //check instead of timing
+        assert(!parsed[13], "duplicate option: " + std::string(argv[idx]));
+
+        args_.verify = true;
+
+        parsed[13] = true;
+        return 1;
+    }
+    return 0;
+}
+
+bool parseHelp(int argc, char* argv[]) {
+    for (int idx = 1; idx < argc; idx++)
+        if (!std::strcmp(argv[idx], "-h") || !std::strcmp(argv[idx], "--help"))
+            return true;
+    return false;
+}
+
+bool parseArgs(int argc, char* argv[]) {
+    //default value of args
+    args_.sizes = argtonlist<size_t>(DEF_SIZES, "sizes");
+    args_.ratios = argtonlist<float>(DEF_RATIOS, "ratios");
+    args_.threads = { 1, std::max<int>(std::thread::hardware_concurrency(), 1) };
+    args_.kernel = GLK_AVX2;
+    args_.quota = DEF_TIME;
+    args_.seed = DEF_SEED;
+    args_.cwidth = DEF_CANVASW;
+    args_.cheight = DEF_CANVASH;
+    args_.tolerance = DEF_TOLERANCE;
+
+    try {
+        std::array<bool, 14> parsed_options = {};    //init state for options
+
+        for (int ret, idx = 1; idx < argc; idx += ret) {
+            if ((ret = matchOptionalArgs(argc, argv, idx, parsed_options))) continue;
+            throw ParseError("unknow argument: " + std::string(argv[idx]));
+        }
+
+        std::sort(args_.threads.begin(), args_.threads.end());
+        args_.threads.erase(std::unique(args_.threads.begin(), args_.threads.end()), args_.threads.end());
+    } catch (ParseError& pe) {
+        std::cerr << pe.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/* a baseline line is <name>,<unit>,<rate>,... */
+bool loadBaseline() {
+    std::ifstream file(args_.baseline);
+    if (!file.is_open()) return false;
+    std::string line;
+    std::getline(file, line);   //header
+    while (std::getline(file, line)) {
+        std::istringstream data(line);
+        std::string name, unit, rate;
+        if (std::getline(data, name, ',') && std::getline(data, unit, ',') && std::getline(data, rate, ','))
+            baseline_[name] = std::strtod(rate.c_str(), nullptr);
+    }
+    return true;
+}
+
+/* the cases of a group are skipped, and their maps never allocated, unless the
+ * filter is a prefix of a case or a case is a prefix of the filter
+ */
+bool wanted(const std::string& name) {
+    size_t len = std::min(name.size(), args_.filter.size());
+    return !name.compare(0, len, args_.filter, 0, len);
+}
+
+std::string format(float ratio) {
+    std::ostringstream data;
+    data << ratio;
+    return data.str();
+}
+
+std::string mode(bool boundless) { return (boundless) ? "boundless" : "bounded"; }
+
+void setup(GLMap& map, int nthreads) {
+    map.threads(nthreads);
+    map.kernel(args_.kernel);
+    map.layout(args_.layout);
+    map.tiles(args_.tiles);
+}
+
+/* place the pattern at the middle of the map */
+void place(GLMap& map, const GLPoint pattern[], size_t size) {
+    long width = 0, height = 0;
+    for (size_t i = 0; i < size; i++) width = std::max(width, pattern[i].x + 1), height = std::max(height, pattern[i].y + 1);
+    std::vector<GLPoint> coord(pattern, pattern + size);
+    for (auto& pt : coord) pt.x += (long(map.width()) - width) / 2, pt.y += (long(map.height()) - height) / 2;
+    map.init(coord.data(), coord.size());
+}
+
+/* repeat() does a unit of work and gives its size, it is repeated until the quota
+ * is spent, at least once, and only the time spent in repeat() counts, prepare()
+ * runs before every repetition without being timed
+ */
+template<class Fn>
+void bench(const std::string& name, const char* unit, Fn repeat, std::function<size_t()> memory, std::function<void()> prepare = nullptr) {
+    using clock = std::chrono::steady_clock;
+    if (name.compare(0, args_.filter.size(), args_.filter)) return;
+
+    double units = 0;
+    std::chrono::duration<double> elapsed{};
+    do {
+        if (prepare) prepare();
+        auto start = clock::now();
+        units += double(repeat());
+        elapsed += clock::now() - start;
+    } while (elapsed.count() < args_.quota);
+
+    Result result = { name, unit, (elapsed.count() > 0) ? units / elapsed.count() : 0, elapsed.count(), memory() };
+    results_.push_back(result);
+
+    std::cout << "  " << std::left << std::setw(40) << result.name << std::right;
+    std::cout << std::scientific << std::setprecision(3) << std::setw(12) << result.rate << ' ' << std::left << std::setw(8) << result.unit << std::right;
+    std::cout << std::fixed << std::setprecision(1) << std::setw(10) << result.memory / double(1 << 20) << " MiB";
+    auto it = baseline_.find(name);
+    if (it != baseline_.end() && it->second > 0) {
+        double change = (result.rate / it->second - 1) * 100;
+        bool regressed = change < -args_.tolerance;
+        regressions_ += regressed;
+        std::cout << std::showpos << std::setw(9) << change << '%' << std::noshowpos << ((regressed) ? "  REGRESSION" : "");
+    }
+    std::cout << std::endl;
+}
+
+void benchInit(size_t size) {
+    if (!wanted("init/")) return;
+    GLMap map(size, size);
+    setup(map, 1);
+    auto memory = [&map]() { return map.memory(); };
+    bench("init/clear/" + std::to_string(size), "cell/s", [&]() { map.init(); return size * size; }, memory);
+    for (int nthreads : args_.threads) {
+        if (!wanted("init/soup/")) break;
+        map.threads(nthreads);
+        for (float ratio : args_.ratios) {
+            std::string name = "init/soup/" + std::to_string(size) + '/' + format(ratio) + "/j" + std::to_string(nthreads);
+            bench(name, "cell/s", [&]() { map.init(ratio, args_.seed); return size * size; }, memory);
+        }
+    }
+    map.threads(1);
+    bench("init/coord/" + std::to_string(size), "cell/s", [&]() { place(map, GUN, sizeof(GUN) / sizeof(GUN[0])); return size * size; }, memory);
+}
+
+/* the map is set up again before every repetition, so every case times the same
+ * generation whatever the speed, and runs on two machines compare the same work
+ */
+void benchNext(size_t size) {
+    if (!wanted("next/")) return;
+    GLMap map(size, size);
+    setup(map, 1);
+    auto memory = [&map]() { return map.memory(); };
+    auto step = [&map, size](bool boundless) { return [&map, size, boundless]() { map.next(boundless); return size * size; }; };
+    for (int nthreads : args_.threads) {
+        map.threads(nthreads);
+        std::string suffix = "/j" + std::to_string(nthreads);
+        for (bool boundless : { false, true }) {
+            for (float ratio : args_.ratios) {
+                std::string name = "next/soup/" + std::to_string(size) + '/' + format(ratio) + '/' + mode(boundless) + suffix;
+                if (!wanted(name)) continue;
+                bench(name, "cell/s", step(boundless), memory, [&map, ratio]() { map.init(ratio, args_.seed); });
+            }
+            std::string name = "next/gun/" + std::to_string(size) + '/' + mode(boundless) + suffix;
+            if (wanted(name)) bench(name, "cell/s", step(boundless), memory, [&map]() { place(map, GUN, sizeof(GUN) / sizeof(GUN[0])); });
+            name = "next/rpent/" + std::to_string(size) + '/' + mode(boundless) + suffix;
+            if (wanted(name)) bench(name, "cell/s", step(boundless), memory, [&map]() { place(map, RPENT, sizeof(RPENT) / sizeof(RPENT[0])); });
+        }
+    }
+}
+
+/* the drawing cases paint a soup of the middle ratio, centred as in the window,
+ * only the painting is timed, the generations between two paints are not, and
+ * the rates are in frames, whatever the number of pixels painted in a frame
+ */
+void benchDraw(size_t size) {
+    if (!wanted("draw/")) return;
+    GLMap map(size, size);
+    setup(map, args_.threads.back());
+    map.init(args_.ratios[args_.ratios.size() / 2], args_.seed);
+
+    GLCanvas canvas;
+    GLMipmap mipmap;
+    canvas.resize(args_.cwidth, args_.cheight);
+    auto rows = [&map](size_t y, size_t x) { return (const char*)map[y] + x; };
+    auto memory = [&]() { return canvas.memory() + mipmap.memory(); };
+    long left = (args_.cwidth - long(size) - 2) / 2, top = (args_.cheight - long(size) - 2) / 2;
+
+    bench("draw/full/" + std::to_string(size), "frame/s", [&]() {
+        canvas.invalidate();
+        canvas.render(size, size, rows, left, top, 1, PALETTE);
+        return 1;
+    }, memory);
+
+    auto step = [&map]() { map.next(false); };
+    bench("draw/diff/" + std::to_string(size), "frame/s", [&]() {
+        canvas.render(size, size, rows, left, top, 1, PALETTE);
+        return 1;
+    }, memory, step);
+
+    if (wanted("draw/frame/")) {    //the worker owns the map until it is destroyed
+        GLWorker worker(map);
+        GLRect view = canvas.visible(size, size, left, top, 1);
+        worker.view(view);
+        auto publish = [&worker, &view]() {
+            size_t gen = worker.frame().gen + 1;
+            worker.step(1);
+            while (!worker.update() || worker.frame().gen < gen || !worker.frame().covers(view)) std::this_thread::yield();
+        };
+        auto rows = [&worker](size_t y, size_t x) { return worker.frame().row(y, x); };
+        canvas.invalidate();
+        bench("draw/frame/" + std::to_string(size), "frame/s", [&]() {
+            canvas.render(size, size, rows, left, top, 1, PALETTE);
+            return 1;
+        }, [&]() { return canvas.memory() + worker.frame().cells.size(); }, publish);
+    }
+
+    if (!wanted("draw/mipmap/") && !wanted("draw/zoom/")) return;
+    map.tiles(true);    //the mipmap takes the changes from the tiles, as from a worker
+    mipmap.update(map);
+    bench("draw/mipmap/" + std::to_string(size), "frame/s", [&]() {
+        mipmap.update(map);
+        return 1;
+    }, memory, step);
+
+    int shrink = 0;
+    while (long((size + (size_t(1) << shrink) - 1) >> shrink) + 2 > std::min(args_.cwidth, args_.cheight)) shrink++;
+    long blocks = long((size + (size_t(1) << shrink) - 1) >> shrink);
+    left = (args_.cwidth - blocks - 2) / 2, top = (args_.cheight - blocks - 2) / 2;
+    bench("draw/zoom/" + std::to_string(size), "frame/s", [&]() {
+        canvas.render(mipmap, left, top, shrink, PALETTE);
+        return 1;
+    }, memory);
+}
+
+/* the cells flipped halfway, as an edit of the window would, and the cells compared */
+bool alive(const GLMap& map, size_t x, size_t y) { return map[y][x]; }
+void flip(GLMap& map, size_t x, size_t y) { map[y][x] = !map[y][x]; map.touch(x, y); }
+bool alive(const GLBitMap& map, size_t x, size_t y) { return map.get(x, y); }
+void flip(GLBitMap& map, size_t x, size_t y) { map.set(x, y, !map.get(x, y)); }
+
+/* a map under test, stepped in lockstep with the reference, until a cell differs */
+struct Subject {
+    std::string name;
+    std::function<void(size_t, size_t)> alloc;
+    std::function<void(const GLRule&, float)> init;
+    std::function<void(size_t, size_t)> flip;
+    std::function<void(bool)> next;
+    std::function<bool(const GLMap&, size_t&, size_t&)> differs;    //at the first cell found
+    std::string diff;
+    size_t gens = 0;
+};
+
+template<class Map>
+Subject subject(const std::string& name, std::function<void(Map&)> setup) {
+    auto map = std::make_shared<std::unique_ptr<Map>>();
+    Subject sub;
+    sub.name = name;
+    sub.alloc = [map, setup](size_t width, size_t height) { map->reset(new Map(width, height)); setup(**map); };
+    sub.init = [map](const GLRule& rule, float ratio) { (*map)->rule(rule); (*map)->init(ratio, args_.seed); };
+    sub.flip = [map](size_t x, size_t y) { flip(**map, x, y); };
+    sub.next = [map](bool boundless) { (*map)->next(boundless); };
+    sub.differs = [map](const GLMap& ref, size_t& x, size_t& y) {
+        for (y = 0; y < ref.height(); y++)
+            for (x = 0; x < ref.width(); x++)
+                if (alive(**map, x, y) != alive(ref, x, y)) return true;
+        return false;
+    };
+    return sub;
+}
+
+/* the subjects and a flat reference map stepped cell by cell by the per-cell path
+ * start from the same soups of every rule, mode, size and ratio, and get the same
+ * cells flipped halfway, a subject is dropped at its first difference
+ */
+void verify(std::vector<Subject>& subjects) {
+    for (auto& size : VERIFY_SIZES) {
+        size_t width = size[0], height = size[1];
+        GLMap ref(width, height);
+        std::vector<char> cells(width * height);
+        for (auto& sub : subjects) sub.alloc(width, height);
+        for (const char* str : VERIFY_RULES) {
+            GLRule rule;
+            parseRule(str, rule);
+            ref.rule(rule);
+            for (bool boundless : { false, true }) {
+                for (float ratio : args_.ratios) {
+                    ref.init(ratio, args_.seed);
+                    for (auto& sub : subjects) if (sub.diff.empty()) sub.init(rule, ratio);
+                    std::minstd_rand random(args_.seed);
+                    for (size_t gen = 1; gen <= DEF_VERIFYGENS; gen++) {
+                        for (size_t i = 0; gen == DEF_VERIFYGENS / 2 && i <= width * height / 16; i++) {
+                            size_t x = random() % width, y = random() % height;
+                            flip(ref, x, y);
+                            for (auto& sub : subjects) if (sub.diff.empty()) sub.flip(x, y);
+                        }
+                        for (size_t y = 0; y < height; y++)
+                            for (size_t x = 0; x < width; x++) cells[y * width + x] = ref.cell(x, y, boundless);
+                        for (size_t y = 0; y < height; y++) memcpy(ref[y], &cells[y * width], width);
+                        for (auto& sub : subjects) {
+                            if (!sub.diff.empty()) continue;
+                            sub.next(boundless);
+                            sub.gens++;
+                            size_t x, y;
+                            if (!sub.differs(ref, x, y)) continue;
+                            std::ostringstream diff;
+                            diff << str << ' ' << mode(boundless) << ' ' << width << 'x' << height << ' ' << format(ratio);
+                            diff << ": generation " << gen << ", cell (" << x << ", " << y << ")";
+                            sub.diff = diff.str();
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* every kernel the CPU has and layout, with and without tiles, on every number of
+ * threads, and the bit engine with every column kernel, whose single thread steps
+ * the alive rows of bounded maps and the others bands of words
+ */
+size_t verifyAll() {
+    static const char* kernels[] = { "scalar", "sse2", "avx2" };
+    static const char* layouts[] = { "flat", "padded" };
+    std::vector<Subject> subjects;
+    for (int level = GLK_SCALAR; level <= detectKernel(); level++)
+        for (int layout : { GLM_FLAT, GLM_PADDED })
+            for (bool tiles : { false, true })
+                for (int nthreads : args_.threads) {
+                    std::string name = std::string("verify/") + kernels[level] + '/' + layouts[layout] + '/' + ((tiles) ? "tiles" : "flat") + "/j" + std::to_string(nthreads);
+                    if (name.compare(0, args_.filter.size(), args_.filter)) continue;
+                    subjects.push_back(subject<GLMap>(name, [=](GLMap& map) {
+                        map.threads(nthreads);
+                        map.kernel(level);
+                        map.layout(layout);
+                        map.tiles(tiles);
+                    }));
+                }
+    for (int level = GLK_SCALAR; level <= detectKernel(); level++)
+        for (int nthreads : args_.threads) {
+            std::string name = std::string("verify/bit/") + kernels[level] + "/j" + std::to_string(nthreads);
+            if (name.compare(0, args_.filter.size(), args_.filter)) continue;
+            subjects.push_back(subject<GLBitMap>(name, [=](GLBitMap& map) {
+                map.threads(nthreads);
+                map.kernel(level);
+            }));
+        }
+    verify(subjects);
+
+    size_t mismatches = 0;
+    for (auto& sub : subjects) {
+        std::cout << "  " << std::left << std::setw(40) << sub.name << std::right;
+        if (sub.diff.empty()) std::cout << "ok after " << sub.gens << " generations" << std::endl;
+        else std::cout << "MISMATCH " << sub.diff << std::endl;
+        mismatches += !sub.diff.empty();
+    }
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    if (parseHelp(argc, argv)) {
+        std::cout << USAGE << std::endl;
+        return RETVAL_EXIT;
+    }
+    if (!parseArgs(argc, argv)) return RETVAL_BADARGS;
+    if (!args_.baseline.empty() && !loadBaseline()) {
+        std::cerr << "unable to open file: " << args_.baseline << std::endl;
+        return RETVAL_ERROPEN;
+    }
+
+    static const char* kernels[] = { "scalar", "sse2", "avx2" };
+    static const char* layouts[] = { "flat", "padded" };
+    GLMap probe(1, 1);
+    setup(probe, 1);
+    std::cout << "  kernel = " << kernels[probe.kernel()] << "  ";
+    std::cout << "layout = " << layouts[probe.layout()] << (args_.tiles ? "/tiles" : "") << "  ";
+    std::cout << "seed = " << args_.seed << "  ";
+    std::cout << "quota = " << args_.quota << " s  ";
+    std::cout << "canvas = " << args_.cwidth << 'x' << args_.cheight << "  ";
+    std::cout << "cores = " << std::thread::hardware_concurrency() << '\n';
+    std::cout << std::string(80, '-') << std::endl;
+
+    if (args_.verify) {
+        size_t mismatches = verifyAll();
+        std::cout << std::string(80, '-') << '\n';
+        std::cout << "  mismatches = " << mismatches << std::endl;
+        return (mismatches) ? RETVAL_MISMATCH : RETVAL_EXIT;
+    }
+
+    for (size_t size : args_.sizes) {
+        benchInit(size);
+        benchNext(size);
+        benchDraw(size);
+    }
+
+    if (!args_.output.empty()) {
+        std::ofstream output(args_.output);
+        output << "name,unit,rate,seconds,memory\n";
+        for (auto& result : results_)
+            output << result.name << ',' << result.unit << ',' << result.rate << ',' << result.seconds << ',' << result.memory << '\n';
+        if (!output.flush()) {
+            std::cerr << "unable to write results: " << args_.output << std::endl;
+            return RETVAL_ERROPEN;
+        }
+    }
+    if (!baseline_.empty()) {
+        std::cout << std::string(80, '-') << '\n';
+        std::cout << "  regressions = " << regressions_ << " beyond " << args_.tolerance << "%" << std::endl;
+    }
+    return (regressions_) ? RETVAL_REGRESS : RETVAL_EXIT;
+}
@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "glmap.h"
+#include "glpool.h"
+
+
+#define GLB_WORDBITS    64
+#define GLB_TILE        8       //rows of a tile, the cells skipped together once they repeat
+
+
+inline size_t popcount64(uint64_t word) {
+#ifdef _MSC_VER
+    return (size_t)__popcnt64(word);
+#else
+    return (size_t)__builtin_popcountll(word);
+#endif
+}
+
+inline size_t ctz64(uint64_t word) {   //the word is not zero
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, word);
+    return idx;
+#else
+    return (size_t)__builtin_ctzll(word);
+#endif
+}
+
+inline size_t clz64(uint64_t word) {   //the word is not zero
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse64(&idx, word);
+    return GLB_WORDBITS - 1 - idx;
+#else
+    return (size_t)__builtin_clzll(word);
+#endif
+}
+
+/* counting neighbours with bitwise adders:
+ * the upper and lower rows contribute 2-bit sums of three cells, the middle row
+ * contributes a 2-bit sum of two cells, and a cell survives or is born iff the
+ * total count is 2 or 3, i.e. the weight-2 part of the total is exactly 1,
+ * row r of west/center/east is the r-th row shifted so that bit i holds the
+ * west/own/east neighbour of the cell at bit i
+ */
+inline uint64_t stepWord(const uint64_t west[3], const uint64_t center[3], const uint64_t east[3]) {
+    uint64_t t0 = west[0] ^ center[0] ^ east[0];
+    uint64_t t1 = (west[0] & center[0]) | (east[0] & (west[0] ^ center[0]));
+    uint64_t b0 = west[2] ^ center[2] ^ east[2];
+    uint64_t b1 = (west[2] & center[2]) | (east[2] & (west[2] ^ center[2]));
+    uint64_t m0 = west[1] ^ east[1];
+    uint64_t m1 = west[1] & east[1];
+
+    uint64_t x0 = t0 ^ m0 ^ b0;                         //weight-1 bit of the total
+    uint64_t c0 = (t0 & m0) | (b0 & (t0 ^ m0));         //carry into weight 2
+    uint64_t s1 = t1 ^ m1, s2 = b1 ^ c0;
+    uint64_t y0 = s1 ^ s2;                              //weight-2 bit of the total
+    uint64_t y1 = (t1 & m1) | (b1 & c0) | (s1 & s2);    //any weight-4 contribution
+
+    return y0 & ~y1 & (x0 | center[1]);
+}
+
+/* select b where sel is set and a elsewhere */
+inline uint64_t mux64(uint64_t a, uint64_t b, uint64_t sel) { return a ^ ((a ^ b) & sel); }
+
+/* the same adders carried on to the exact count in four bit planes, the weight-2
+ * part of the total is t1 + m1 + b1 + c0, where at most two of its pairs are both set,
+ * then each mask of the rule is looked up by a tree of multiplexers over the planes
+ */
+inline uint64_t stepWord(const uint64_t west[3], const uint64_t center[3], const uint64_t east[3], const GLRule& rule) {
+    uint64_t t0 = west[0] ^ center[0] ^ east[0];
+    uint64_t t1 = (west[0] & center[0]) | (east[0] & (west[0] ^ center[0]));
+    uint64_t b0 = west[2] ^ center[2] ^ east[2];
+    uint64_t b1 = (west[2] & center[2]) | (east[2] & (west[2] ^ center[2]));
+    uint64_t m0 = west[1] ^ east[1];
+    uint64_t m1 = west[1] & east[1];
+
+    uint64_t c0 = (t0 & m0) | (b0 & (t0 ^ m0));
+    uint64_t s1 = t1 ^ m1, s2 = b1 ^ c0;
+    uint64_t p1 = t1 & m1, p2 = b1 & c0, p3 = s1 & s2;
+    uint64_t w1 = t0 ^ m0 ^ b0, w2 = s1 ^ s2, w4 = p1 ^ p2 ^ p3, w8 = p1 & p2;   //the weights of the count
+
+    auto lookup = [=](uint16_t mask) {
+        auto leaf = [mask](unsigned n) { return uint64_t(0) - ((mask >> n) & 1); };
+        uint64_t lo = mux64(mux64(leaf(0), leaf(1), w1), mux64(leaf(2), leaf(3), w1), w2);
+        uint64_t hi = mux64(mux64(leaf(4), leaf(5), w1), mux64(leaf(6), leaf(7), w1), w2);
+        return mux64(mux64(lo, hi, w4), leaf(8), w8);
+    };
+    return mux64(lookup(rule.birth), lookup(rule.survive), center[1]);
+}
+
+/* bit-packed map, 64 cells per word:
+ * each row occupies _words words, bit i of word k is the cell at x = k * 64 + i,
+ * the padding bits beyond the width of a row are always kept as zero,
+ * the rows out of which all cells are dead are kept per column of words for both
+ * buffers, so that a bounded map on one thread only steps the words around its
+ * alive cells
+ */
+class GLBitMap {
+public:
+    GLBitMap(size_t width, size_t height)
+        :_width(width), _height(height), _words((width + GLB_WORDBITS - 1) / GLB_WORDBITS), _gen(0) { _alloc(); }
+    GLBitMap(const GLBitMap&) = delete;
+    GLBitMap(GLBitMap&&) = delete;
+    ~GLBitMap() { _free(); }
+
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    size_t gen() const { return _gen; }
+    void gen(size_t gen) { _gen = gen; }
+    bool valid(size_t x, size_t y) const { return (x < _width && y < _height); }
+    size_t population() const;
+    bool bounds(GLRect& rect) const { uint64_t hash; return _bounds<false>(rect, hash); }
+    bool bounds(GLRect& rect, uint64_t& hash) const { return _bounds<true>(rect, hash); }  //with a hash of the alive cells at their places
+    size_t threads() const { return (_pool) ? _pool->size() : 1; }
+    void threads(size_t nthreads) { _pool.reset((nthreads > 1) ? new GLPool(nthreads) : nullptr); }
+    const GLRule& rule() const { return _rule; }
+    void rule(const GLRule& rule) { _rule = rule; }
+    int kernel() const { return _level; }
+    void kernel(int level) { _level = std::min(std::max(level, GLK_SCALAR), detectKernel()); _step = columnKernel(_level); }    //of the Conway columns
+    size_t words() const { return _words; }
+    uint64_t* row(size_t y) { _full = true, _stale = 2; return _mfront + y * _words; }  //the padding bits must be kept as zero
+    const uint64_t* row(size_t y) const { return _mfront + y * _words; }
+
+    bool get(size_t x, size_t y) const { return (_mfront[_index(x, y)] >> (x % GLB_WORDBITS)) & 1; }
+    void set(size_t x, size_t y, bool alive);
+
+    void init();
+    void init(float ratio, unsigned seed = std::minstd_rand::default_seed);
+    void init(const bool map[], size_t size);
+    void init(const GLPoint coord[], size_t size);
+    void init(const GLRect rect[], size_t size);
+    void next(bool boundless = false);
+
+private:
+    size_t _width, _height, _words, _gen;
+    size_t* _mrange, * _brange;     //per column of words, the rows out of which all cells of the front and back buffers are dead
+    bool _full;     //the rows of the front buffer are not known, any cell may be alive
+    size_t _tiles;  //per column of words, with a quiet tile above and below
+    uint8_t* _mtiles, * _btiles;    //per tile of both buffers, whether a cell next to it differs from two generations before
+    unsigned _stale;    //generations to step before the tiles are known
+    uint64_t* _mfront, * _mback;
+    uint64_t* _mzero;   //a dead row used as the outer rows of bounded maps
+    uint64_t* _mcolumn;     //the shifted words of a column and its next words for the column kernel
+    int _level = detectKernel();
+    GLColumnKernel _step = columnKernel(_level);
+    std::unique_ptr<GLPool> _pool;
+    GLRule _rule = GLR_CONWAY;
+
+    void _alloc();
+    void _free() { delete[] _mfront; delete[] _mback; delete[] _mzero; delete[] _mcolumn; delete[] _mrange; delete[] _brange; delete[] _mtiles; delete[] _btiles; }
+    size_t _index(size_t x, size_t y) const { return y * _words + x / GLB_WORDBITS; }
+    uint64_t _tailmask() const { return ~uint64_t(0) >> (_words * GLB_WORDBITS - _width); }
+    void _fill(size_t row, size_t left, size_t right);
+    void _row(uint64_t* dst, const uint64_t* up, const uint64_t* mid, const uint64_t* down, bool boundless) const;
+    void _band(size_t top, size_t bottom, bool boundless);
+    void _known();
+    template<bool Hashed>
+    bool _bounds(GLRect& rect, uint64_t& hash) const;
+    void _wake(size_t k, size_t t, uint64_t diff, uint64_t top, uint64_t bottom);
+    template<bool West, bool East>
+    void _stripe(size_t k, size_t top, size_t bottom, size_t& first, size_t& end);
+    template<bool West, bool East, bool Conway>
+    void _column(size_t k, size_t top, size_t bottom, size_t& first, size_t& end);
+    void _live();
+};
+
+inline void GLBitMap::_alloc() {
+    _mfront = new uint64_t[_words * _height]();
+    _mback = new uint64_t[_words * _height]();
+    _mzero = new uint64_t[_words]();
+    _mcolumn = new uint64_t[4 * (_height + 2)];
+    _mrange = new size_t[2 * _words];
+    _brange = new size_t[2 * _words];
+    for (size_t k = 0; k < _words; k++) _brange[2 * k] = 0, _brange[2 * k + 1] = _height;
+    _full = true;
+    _tiles = (_height + GLB_TILE - 1) / GLB_TILE + 2;
+    _mtiles = new uint8_t[_words * _tiles]();
+    _btiles = new uint8_t[_words * _tiles]();
+    _stale = 2;
+}
+
+/* the rows of the front buffer taken as all rows once they are not known */
+inline void GLBitMap::_known() {
+    if (!_full) return;
+    for (size_t k = 0; k < _words; k++) _mrange[2 * k] = 0, _mrange[2 * k + 1] = _height;
+    _full = false;
+}
+
+inline size_t GLBitMap::population() const {
+    size_t cnt = 0;
+    for (size_t k = 0; k < _words; k++)
+        for (size_t y = (_full) ? 0 : _mrange[2 * k]; y < ((_full) ? _height : _mrange[2 * k + 1]); y++) cnt += popcount64(_mfront[y * _words + k]);
+    return cnt;
+}
+
+/* the words of the alive rows are hashed on the way, each mixed on its own and
+ * keyed by its place, so the dead words do not count
+ */
+template<bool Hashed>
+inline bool GLBitMap::_bounds(GLRect& rect, uint64_t& hash) const {
+    rect = { long(_width), long(_height), 0, 0 };
+    hash = 0;
+    for (size_t k = 0; k < _words; k++) {   //a column of words at a time, trimmed to its alive rows
+        const uint64_t* column = _mfront + k;
+        size_t top = (_full) ? 0 : _mrange[2 * k], bottom = (_full) ? _height : _mrange[2 * k + 1];
+        while (top < bottom && !column[top * _words]) top++;
+        while (bottom > top && !column[(bottom - 1) * _words]) bottom--;
+        if (top >= bottom) continue;    //an empty range may be reversed
+        uint64_t any = 0;
+        for (size_t y = top; y < bottom; y++) {
+            uint64_t word = column[y * _words], mix = (word + (uint64_t(y) << 32 | k)) * 0x9e3779b97f4a7c15ull;
+            any |= word;
+            if (Hashed) hash += (mix ^ (mix >> 29)) & (uint64_t(0) - (word != 0));
+        }
+        rect.top = std::min(rect.top, long(top));
+        rect.bottom = std::max(rect.bottom, long(bottom));
+        long x = long(k * GLB_WORDBITS);
+        rect.left = std::min(rect.left, x + long(ctz64(any)));
+        rect.right = std::max(rect.right, x + GLB_WORDBITS - long(clz64(any)));
+    }
+    return rect.left < rect.right;
+}
+
+inline void GLBitMap::set(size_t x, size_t y, bool alive) {
+    uint64_t bit = uint64_t(1) << (x % GLB_WORDBITS);
+    _mfront[_index(x, y)] = (alive) ? (_mfront[_index(x, y)] | bit) : (_mfront[_index(x, y)] & ~bit);
+    size_t k = x / GLB_WORDBITS;
+    _stale = 2;
+    if (alive && !_full) _mrange[2 * k] = std::min(_mrange[2 * k], y), _mrange[2 * k + 1] = std::max(_mrange[2 * k + 1], y + 1);
+}
+
+inline void GLBitMap::_fill(size_t row, size_t left, size_t right) {
+    for (size_t x = left; x < right;) {
+        size_t bits = std::min(GLB_WORDBITS - x % GLB_WORDBITS, right - x);
+        uint64_t mask = (bits == GLB_WORDBITS) ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1) << (x % GLB_WORDBITS);
+        _mfront[_index(x, row)] |= mask;
+        x += bits;
+    }
+}
+
+inline void GLBitMap::init() {
+    _gen = 0;
+    size_t top = _height, bottom = 0;
+    for (size_t k = 0; k < _words; k++) top = std::min(top, (_full) ? 0 : _mrange[2 * k]), bottom = std::max(bottom, (_full) ? _height : _mrange[2 * k + 1]);
+    if (top < bottom) memset(_mfront + top * _words, 0, sizeof(uint64_t) * _words * (bottom - top));
+    for (size_t k = 0; k < _words; k++) _mrange[2 * k] = _height, _mrange[2 * k + 1] = 0;
+    _full = false;
+    _stale = 2;
+}
+
+inline void GLBitMap::init(float ratio, unsigned seed /*std::minstd_rand::default_seed*/) {
+    _gen = 0;
+    _full = true, _stale = 2;
+    GLSoup soup(ratio, seed);   //the same soup as GLMap
+    size_t nbands = (_pool) ? std::min(_pool->size(), _height) : 1;
+    std::function<void(size_t)> band = [this, &soup, nbands](size_t i) {
+        for (size_t y = _height * i / nbands; y < _height * (i + 1) / nbands; y++) soup.row(y, row(y), _width);
+    };
+    if (_pool) _pool->run(nbands, band);
+    else band(0);
+}
+
+inline void GLBitMap::init(const bool map[], size_t size) {
+    init();
+    for (size_t i = 0; i < std::min(size, _width * _height); i++) {
+        if (map[i]) set(i % _width, i / _width, true);
+    }
+}
+
+inline void GLBitMap::init(const GLPoint coord[], size_t size) {
+    init();
+    for (size_t i = 0; i < size; i++) {
+        auto& pt = coord[i];
+        if (valid(pt.x, pt.y)) set(pt.x, pt.y, true);
+    }
+}
+
+inline void GLBitMap::init(const GLRect rect[], size_t size) {
+    init();
+    for (size_t i = 0; i < size; i++) {
+        long left = std::max(rect[i].left, 0L), right = std::min(rect[i].right, (long)_width);
+        long top = std::max(rect[i].top, 0L), bottom = std::min(rect[i].bottom, (long)_height);
+        for (long row = top; left < right && row < bottom; row++) _fill(row, left, right);
+    }
+    _full = true, _stale = 2;
+}
+
+inline void GLBitMap::_row(uint64_t* dst, const uint64_t* up, const uint64_t* mid, const uint64_t* down, bool boundless) const {
+    size_t last = _words - 1, tail = (_width - 1) % GLB_WORDBITS;
+    const uint64_t* rows[3] = { up, mid, down };
+    uint64_t lcarry[3], rcarry[3];  //the cells outside of the west and east edges
+    bool conway = _rule.conway();
+    for (int r = 0; r < 3; r++) {
+        lcarry[r] = (boundless) ? (rows[r][last] >> tail) & 1 : 0;
+        rcarry[r] = (boundless) ? rows[r][0] & 1 : 0;
+    }
+
+    for (size_t k = 0; k < _words; k++) {
+        uint64_t west[3], center[3], east[3];
+        for (int r = 0; r < 3; r++) {
+            uint64_t prev = (k > 0) ? rows[r][k - 1] >> (GLB_WORDBITS - 1) : lcarry[r];
+            uint64_t succ = (k < last) ? rows[r][k + 1] << (GLB_WORDBITS - 1) : rcarry[r] << tail;
+            center[r] = rows[r][k];
+            west[r] = (center[r] << 1) | prev;
+            east[r] = (center[r] >> 1) | succ;
+        }
+        dst[k] = (conway) ? stepWord(west, center, east) : stepWord(west, center, east, _rule);
+    }
+    dst[last] &= _tailmask();
+}
+
+inline void GLBitMap::_band(size_t top, size_t bottom, bool boundless) {
+    for (size_t y = top; y < bottom; y++) {
+        const uint64_t* up = (y > 0) ? _mfront + (y - 1) * _words : (boundless) ? _mfront + (_height - 1) * _words : _mzero;
+        const uint64_t* down = (y + 1 < _height) ? _mfront + (y + 1) * _words : (boundless) ? _mfront : _mzero;
+        _row(_mback + y * _words, up, _mfront + y * _words, down, boundless);
+    }
+}
+
+/* the tiles of the back buffer next to the cells of tile t in column k that differ
+ * from two generations before are marked, given the cells changed in the tile and
+ * in its top and bottom rows
+ */
+inline void GLBitMap::_wake(size_t k, size_t t, uint64_t diff, uint64_t top, uint64_t bottom) {
+    if (!diff) return;
+    const size_t shift = GLB_WORDBITS - 1;
+    uint8_t* tile = _btiles + k * _tiles + t + 1;
+    tile[-1] |= (top != 0), tile[0] = 1, tile[1] |= (bottom != 0);
+    if (k > 0 && (diff & 1)) {  //next to the east edge of the column to the west
+        uint8_t* west = tile - _tiles;
+        west[-1] |= top & 1, west[0] = 1, west[1] |= bottom & 1;
+    }
+    if (k + 1 < _words && (diff >> shift)) {
+        uint8_t* east = tile + _tiles;
+        east[-1] |= top >> shift, east[0] = 1, east[1] |= bottom >> shift;
+    }
+}
+
+/* the rows [top, bottom) of a column of words by the column kernel, the words are
+ * shifted into a row each for it, and the tiles around the words that differ from
+ * two generations before are marked in the back buffer
+ */
+template<bool West, bool East>
+inline void GLBitMap::_stripe(size_t k, size_t top, size_t bottom, size_t& first, size_t& end) {
+    const size_t shift = GLB_WORDBITS - 1, n = bottom - top, stride = _height + 2;
+    const uint64_t mask = (East) ? ~uint64_t(0) : _tailmask();
+    uint64_t* west = _mcolumn, * center = west + stride, * east = center + stride, * dst = east + stride;
+    auto load = [&](const uint64_t* row, size_t i) {   //loaded before any store, which may alias the row
+        uint64_t word = row[k], before = (West) ? row[k - 1] >> shift : 0, after = (East) ? row[k + 1] << shift : 0;
+        center[i] = word, west[i] = (word << 1) | before, east[i] = (word >> 1) | after;
+    };
+    load((top > 0) ? _mfront + (top - 1) * _words : _mzero, 0);
+    const uint64_t* row = _mfront + top * _words;
+    for (size_t i = 1; i <= n; i++, row += _words) load(row, i);
+    load((bottom < _height) ? row : _mzero, n + 1);
+    _step(dst, west, center, east, n);
+
+    uint64_t* out = _mback + top * _words + k;
+    for (size_t y = top; y < bottom;) {     //a tile at a time, whose rows are all kept as alive if any is
+        size_t next = std::min((y / GLB_TILE + 1) * GLB_TILE, bottom), i = y - top;
+        uint64_t word = dst[i] & mask, change = word ^ *out;
+        uint64_t alive = word, diff = change, upper = change, lower = change;   //of the tile and its top and bottom rows
+        for (*out = word, i++, out += _words; i < next - top; i++, out += _words) {
+            word = dst[i] & mask, change = word ^ *out;
+            alive |= word, diff |= change, lower = change;
+            *out = word;
+        }
+        _wake(k, y / GLB_TILE, diff, (y % GLB_TILE == 0) ? upper : 0, (next % GLB_TILE == 0) ? lower : 0);
+        if (alive) first = std::min(first, y), end = next;
+        y = next;
+    }
+}
+
+/* a column of words from top to bottom, West and East tell whether the column
+ * has a column of words on either side, with Conway's rule the tiles are skipped
+ * where no tile around them changed in the two generations before, since the back
+ * buffer already holds their cells, and the others are stepped in runs by the
+ * column kernel, any other rule keeps the three rows around a word in registers,
+ * so only the row below is loaded for the next word, and the words with no alive
+ * cell around them are only cleared
+ */
+template<bool West, bool East, bool Conway>
+inline void GLBitMap::_column(size_t k, size_t top, size_t bottom, size_t& first, size_t& end) {
+    if (Conway) {
+        if (_stale) return _stripe<West, East>(k, top, bottom, first, end);
+        const uint8_t* busy = _mtiles + k * _tiles + 1;
+        for (size_t y = top; y < bottom;) {     //a run of busy or quiet tiles at a time
+            bool run = busy[y / GLB_TILE] != 0;
+            size_t t = y / GLB_TILE + 1;
+            while (t * GLB_TILE < bottom && (busy[t] != 0) == run) t++;
+            size_t next = std::min(t * GLB_TILE, bottom);
+            if (run) {
+                _stripe<West, East>(k, y, next, first, end);
+            } else {    //alive at most where the back buffer was
+                size_t lo = std::max(y, _brange[2 * k]), hi = std::min(next, _brange[2 * k + 1]);
+                if (lo < hi) first = std::min(first, lo), end = std::max(end, hi);
+            }
+            y = next;
+        }
+        return;
+    }
+    const size_t shift = GLB_WORDBITS - 1;
+    const uint64_t mask = (East) ? ~uint64_t(0) : _tailmask();
+    uint64_t w[3] = {}, c[3] = {}, e[3] = {};
+    auto load = [&](const uint64_t* row, int r) {
+        c[r] = row[k];
+        w[r] = (c[r] << 1) | ((West) ? row[k - 1] >> shift : 0);
+        e[r] = (c[r] >> 1) | ((East) ? row[k + 1] << shift : 0);
+    };
+    if (top > 0) load(_mfront + (top - 1) * _words, 0);
+    load(_mfront + top * _words, 1);
+    for (size_t y = top; y < bottom; y++) {
+        load((y + 1 < _height) ? _mfront + (y + 1) * _words : _mzero, 2);
+        uint64_t word = 0;
+        if (w[0] | c[0] | e[0] | w[1] | c[1] | e[1] | w[2] | c[2] | e[2]) {
+            word = stepWord(w, c, e, _rule) & mask;
+            if (word) first = std::min(first, y), end = std::max(end, y + 1);
+        }
+        _mback[y * _words + k] = word;
+        w[0] = w[1], c[0] = c[1], e[0] = e[1];
+        w[1] = w[2], c[1] = c[2], e[1] = e[2];
+    }
+}
+
+/* every column of words over the rows next to the alive cells of the columns
+ * around it, once the words of the column in the back buffer with cells left from
+ * two generations before are cleared
+ */
+inline void GLBitMap::_live() {
+    size_t last = _words - 1;
+    bool conway = _rule.conway();
+    memset(_btiles, 0, _words * _tiles);
+    for (size_t k = 0; k <= last; k++) {
+        size_t top = _mrange[2 * k], bottom = _mrange[2 * k + 1];
+        if (k > 0) top = std::min(top, _mrange[2 * k - 2]), bottom = std::max(bottom, _mrange[2 * k - 1]);
+        if (k < last) top = std::min(top, _mrange[2 * k + 2]), bottom = std::max(bottom, _mrange[2 * k + 3]);
+        top = (top > 0) ? top - 1 : 0, bottom = std::min(bottom + 1, _height);
+        size_t first = _height, end = 0;
+        auto clear = [&](size_t y) {
+            _wake(k, y / GLB_TILE, _mback[y * _words + k], ~uint64_t(0), ~uint64_t(0));
+            _mback[y * _words + k] = 0;
+        };
+        for (size_t y = _brange[2 * k]; y < std::min(top, _brange[2 * k + 1]); y++) clear(y);
+        for (size_t y = std::max(bottom, _brange[2 * k]); y < _brange[2 * k + 1]; y++) clear(y);
+        if (top < bottom) {
+            if (last == 0) (conway) ? _column<false, false, true>(k, top, bottom, first, end) : _column<false, false, false>(k, top, bottom, first, end);
+            else if (k == 0) (conway) ? _column<false, true, true>(k, top, bottom, first, end) : _column<false, true, false>(k, top, bottom, first, end);
+            else if (k == last) (conway) ? _column<true, false, true>(k, top, bottom, first, end) : _column<true, false, false>(k, top, bottom, first, end);
+            else (conway) ? _column<true, true, true>(k, top, bottom, first, end) : _column<true, true, false>(k, top, bottom, first, end);
+        }
+        _brange[2 * k] = first, _brange[2 * k + 1] = end;
+    }
+    std::swap(_mrange, _brange);
+    std::swap(_mtiles, _btiles);
+    _stale = (conway) ? _stale - (_stale > 0) : 2;   //the tiles are only marked by the column kernel
+}
+
+inline void GLBitMap::next(bool boundless /*false*/) {
+    _known();
+    if (!_pool && !boundless && !(_rule.birth & 1)) {   //dead cells stay dead without B0
+        _live();
+        std::swap(_mfront, _mback);
+        _gen++;
+        return;
+    }
+    if (_pool) {
+        size_t nbands = std::min(_pool->size(), _height);
+        _pool->run(nbands, [this, nbands, boundless](size_t i) {
+            _band(_height * i / nbands, _height * (i + 1) / nbands, boundless);
+        });
+    } else {
+        _band(0, _height, boundless);
+    }
+    std::swap(_mfront, _mback);
+    std::swap(_mrange, _brange);
+    _full = true, _stale = 2;
+    _gen++;
+}
@@ -0,0 +1,582 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "glbitmap.h"
+#include "glpool.h"
+
+
+#define GLCS_MARGIN     12      //dead cells at least around the cells of a soup when it moves
+#define GLCS_ALIGN      32      //the sides of the arenas are multiples of it
+#define GLCS_MAXSIDE    1024    //of the largest arena
+#define GLCS_BAND       6       //cells along the edges of the arena where spaceships are caught, more than a soup spreads between two looks
+#define GLCS_CHECK      4       //generations between two looks at the arena
+#define GLCS_SAMPLES    256     //looks remembered, so periods up to this are found
+#define GLCS_MAXSHIP    16      //longest period of a spaceship caught
+#define GLCS_SHIPBOX    16      //largest side of a spaceship caught
+#define GLCS_BATCH      16      //soups taken at once by a thread
+#define GLCS_DEFGENS    20000   //generations for a soup to settle
+
+
+/* what became of the soups of a census, and the objects they left */
+struct GLTally {
+    size_t soups = 0;
+    size_t settled = 0;     //periodic before the generations ran out, the others are still running
+    size_t spilled = 0;     //reached the edges of the arena
+    size_t gens = 0;        //stepped by all soups
+    std::unordered_map<std::string, size_t> objects;
+
+    GLTally& operator+=(const GLTally& rhs);
+};
+
+inline GLTally& GLTally::operator+=(const GLTally& rhs) {
+    soups += rhs.soups;
+    settled += rhs.settled;
+    spilled += rhs.spilled;
+    gens += rhs.gens;
+    for (auto& kv : rhs.objects) objects[kv.first] += kv.second;
+    return *this;
+}
+
+/* the apgcode of an object given by its cells in every phase of its period,
+ * xs<population> for still lifes, xp<period> for oscillators and xq<period> for
+ * spaceships, followed by the extended Wechsler format of the phase and the
+ * orientation giving the shortest code, then the first in alphabetical order,
+ * so every rotation, reflection and phase of an object has the same code
+ */
+inline std::string apgcode(const std::vector<std::vector<GLPoint>>& phases, bool moving) {
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    static const long turns[8][4] = { {1, 0, 0, 1}, {0, 1, -1, 0}, {-1, 0, 0, -1}, {0, -1, 1, 0}, {-1, 0, 0, 1}, {0, 1, 1, 0}, {1, 0, 0, -1}, {0, -1, -1, 0} };
+
+    std::string best;
+    std::vector<char> grid;
+    for (auto& cells : phases) {
+        for (auto& t : turns) {
+            long left = LONG_MAX, top = LONG_MAX, right = LONG_MIN, bottom = LONG_MIN;
+            for (auto& pt : cells) {
+                long x = t[0] * pt.x + t[1] * pt.y, y = t[2] * pt.x + t[3] * pt.y;
+                left = std::min(left, x), right = std::max(right, x + 1);
+                top = std::min(top, y), bottom = std::max(bottom, y + 1);
+            }
+            size_t width = size_t(right - left), height = size_t(bottom - top);
+            grid.assign(width * height, 0);
+            for (auto& pt : cells) grid[size_t(t[2] * pt.x + t[3] * pt.y - top) * width + size_t(t[0] * pt.x + t[1] * pt.y - left)] = 1;
+
+            std::string code;
+            for (size_t strip = 0; strip < height; strip += 5) {   //columns of 5 cells, the top one in the lowest bit
+                if (strip) code += 'z';
+                size_t zeros = 0;
+                for (size_t x = 0; x < width; x++) {
+                    int column = 0;
+                    for (size_t y = strip; y < std::min(strip + 5, height); y++) column |= grid[y * width + x] << (y - strip);
+                    if (!column) { zeros++; continue; }
+                    for (; zeros >= 40; zeros -= 39) code += "yz";  //runs of blank columns, the last ones of a strip dropped
+                    if (zeros == 1) code += '0';
+                    else if (zeros == 2) code += 'w';
+                    else if (zeros == 3) code += 'x';
+                    else if (zeros > 3) code += 'y', code += digits[zeros - 4];
+                    zeros = 0;
+                    code += digits[column];
+                }
+            }
+            if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best)) best = code;
+        }
+    }
+    if (moving) return "xq" + std::to_string(phases.size()) + '_' + best;
+    if (phases.size() > 1) return "xp" + std::to_string(phases.size()) + '_' + best;
+    return "xs" + std::to_string(phases[0].size()) + '_' + best;
+}
+
+/* a census of the objects left by random soups:
+ * each soup is the one of GLMap::init() for a map of the size of the soup, placed
+ * in the middle of a bounded bit-packed arena and stepped until the arena repeats
+ * itself, the alive cells of all its phases are then grouped into clusters of cells
+ * less than 3 cells apart, which evolve on their own, each cluster is split into the
+ * objects evolving on their own inside it, and each object is tallied under its
+ * apgcode with its own period,
+ * the arena is looked at every few generations: a group of cells reaching the
+ * band along the edges that moves away from the middle as a copy of itself is
+ * tallied as a spaceship and erased, any other cells in the band move the soup to
+ * the middle of a larger arena, and it moves to a smaller one once it shrinks,
+ * so the cells stepped follow the extent of the soup, and a soup still reaching
+ * the edges of the largest arena is only counted as spilled, since the edges
+ * changed its evolution,
+ * the arena is hashed at each look instead of every generation, a hash seen k looks
+ * before gives k * GLCS_CHECK generations in which the period is looked for,
+ * every thread takes a worker with its own arenas, scratch map and tally, taken
+ * from a free list as the maps of GLEnsemble, and the tallies are merged at the end
+ */
+class GLCensus {
+public:
+    GLCensus(size_t width, size_t height, size_t nthreads) :_width(width), _height(height), _pool(nthreads) {}
+    GLCensus(const GLCensus&) = delete;
+    GLCensus(GLCensus&&) = delete;
+
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    size_t threads() const { return _pool.size(); }
+    size_t workers() const { return _workers.size(); }
+    const GLTally& tally() const { return _tally; }
+    void setup(const std::function<void(GLBitMap&)>& setup) { _setup = setup; _workers.clear(); _free.clear(); }
+
+    void run(const std::vector<std::pair<unsigned, float>>& soups, size_t gens);
+    std::vector<std::pair<std::string, size_t>> census() const;
+    bool save(std::ostream& out) const;
+
+private:
+    struct Worker {
+        std::vector<std::unique_ptr<GLBitMap>> arenas;  //per size, allocated when a soup first needs it
+        GLBitMap scratch;   //of the spaceships
+        GLTally tally;
+        std::vector<uint64_t> hashes;   //of the last looks at the arena
+        std::vector<int> labels;        //of the cells of the arena, per object
+        std::vector<uint64_t> words;    //of a row of the soup
+        std::vector<GLPoint> cells, group, seeds, moved;
+        std::vector<std::vector<GLPoint>> phases;
+        std::vector<std::vector<std::vector<GLPoint>>> objects;     //phases of every cluster
+        std::unordered_map<std::string, std::vector<std::string>> codes;    //of the objects of the clusters seen in their first phase
+
+        Worker() :scratch(GLCS_SHIPBOX + GLCS_MAXSHIP + 4, GLCS_SHIPBOX + GLCS_MAXSHIP + 4), hashes(GLCS_SAMPLES) {}
+    };
+
+    size_t _width, _height;
+    GLPool _pool;
+    std::function<void(GLBitMap&)> _setup;  //applied once to every new arena
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<Worker*> _free;     //workers not taken by a thread
+    GLTally _tally;
+    std::mutex _mtx;
+
+    Worker* _acquire();
+    void _release(Worker* worker);
+    static size_t _side(long cells) { return std::min<size_t>((size_t(cells) + 2 * GLCS_MARGIN + GLCS_ALIGN - 1) / GLCS_ALIGN * GLCS_ALIGN, GLCS_MAXSIDE); }
+    GLBitMap& _arena(Worker& w, size_t width, size_t height) const;
+    void _soup(Worker& w, unsigned seed, float ratio, size_t gens) const;
+    static void _alive(const GLBitMap& map, const GLRect& rect, std::vector<GLPoint>& cells);
+    static bool _same(const std::vector<GLPoint>& a, const std::vector<GLPoint>& b);
+    static void _group(Worker& w, size_t width, int label, const GLRect& rect);
+    static std::vector<std::string> _split(const std::vector<std::vector<GLPoint>>& phases, const GLRule& rule);
+    bool _ships(Worker& w, GLBitMap& arena, const GLRect& box) const;
+    bool _ship(Worker& w, GLBitMap& arena) const;
+    bool _objects(Worker& w, GLBitMap& arena, size_t gens) const;
+    void _record(Worker& w, std::vector<std::vector<GLPoint>>& phases, bool moving) const;
+};
+
+inline GLCensus::Worker* GLCensus::_acquire() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (!_free.empty()) {
+            Worker* worker = _free.back();
+            _free.pop_back();
+            return worker;
+        }
+    }
+    std::unique_ptr<Worker> worker(new Worker());
+    std::lock_guard<std::mutex> lock(_mtx);
+    _workers.push_back(std::move(worker));
+    return _workers.back().get();
+}
+
+inline void GLCensus::_release(Worker* worker) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _free.push_back(worker);
+}
+
+/* single-threaded, so that an arena up to 64 cells wide is stepped a word per row */
+inline GLBitMap& GLCensus::_arena(Worker& w, size_t width, size_t height) const {
+    size_t sides = GLCS_MAXSIDE / GLCS_ALIGN, idx = (width / GLCS_ALIGN - 1) * sides + height / GLCS_ALIGN - 1;
+    if (w.arenas.empty()) w.arenas.resize(sides * sides);
+    if (!w.arenas[idx]) {
+        w.arenas[idx].reset(new GLBitMap(width, height));
+        GLBitMap& arena = *w.arenas[idx];
+        if (_setup) _setup(arena);
+        arena.threads(1);
+        w.scratch.rule(arena.rule());
+    }
+    if (w.labels.size() < width * height) w.labels.assign(width * height, 0);
+    return *w.arenas[idx];
+}
+
+/* the soups are taken in batches by whichever thread is free, then the tallies
+ * of the workers are merged
+ */
+inline void GLCensus::run(const std::vector<std::pair<unsigned, float>>& soups, size_t gens) {
+    std::function<void(size_t)> task = [this, &soups, gens](size_t i) {
+        Worker* worker = _acquire();
+        for (size_t k = i * GLCS_BATCH; k < std::min((i + 1) * GLCS_BATCH, soups.size()); k++) _soup(*worker, soups[k].first, soups[k].second, gens);
+        _release(worker);
+    };
+    _pool.run((soups.size() + GLCS_BATCH - 1) / GLCS_BATCH, task);
+
+    _tally = {};
+    for (auto& worker : _workers) _tally += worker->tally, worker->tally = {};
+}
+
+/* the most frequent objects first */
+inline std::vector<std::pair<std::string, size_t>> GLCensus::census() const {
+    std::vector<std::pair<std::string, size_t>> census(_tally.objects.begin(), _tally.objects.end());
+    std::sort(census.begin(), census.end(), [](const std::pair<std::string, size_t>& a, const std::pair<std::string, size_t>& b) {
+        return (a.second != b.second) ? a.second > b.second : a.first < b.first;
+    });
+    return census;
+}
+
+/* as CSV, with the share of each object among all of them */
+inline bool GLCensus::save(std::ostream& out) const {
+    size_t total = 0;
+    for (auto& kv : _tally.objects) total += kv.second;
+    out << "object,count,share\n";
+    for (auto& kv : census()) out << kv.first << ',' << kv.second << ',' << double(kv.second) / total << '\n';
+    return bool(out.flush());
+}
+
+/* the alive cells inside the rectangle, row by row */
+inline void GLCensus::_alive(const GLBitMap& map, const GLRect& rect, std::vector<GLPoint>& cells) {
+    cells.clear();
+    size_t first = size_t(rect.left) / GLB_WORDBITS, last = size_t(rect.right - 1) / GLB_WORDBITS;
+    for (long y = rect.top; y < rect.bottom; y++) {
+        const uint64_t* row = map.row(y);
+        for (size_t k = first; k <= last; k++)
+            for (uint64_t word = row[k]; word; word &= word - 1) {
+                long x = long(k * GLB_WORDBITS + ctz64(word));
+                if (x >= rect.left && x < rect.right) cells.push_back({ x, y });
+            }
+    }
+}
+
+inline bool GLCensus::_same(const std::vector<GLPoint>& a, const std::vector<GLPoint>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].x != b[i].x || a[i].y != b[i].y) return false;
+    return true;
+}
+
+/* the unlabelled cells, labelled negative, less than 3 cells apart from the seeds,
+ * and from each other, inside the rectangle, are given the label and put in the
+ * group, cells of different groups cannot interact
+ */
+inline void GLCensus::_group(Worker& w, size_t width, int label, const GLRect& rect) {
+    w.group.clear();
+    for (auto& pt : w.seeds) {
+        int& seen = w.labels[pt.y * width + pt.x];
+        if (seen < 0) seen = label, w.group.push_back(pt);
+    }
+    for (size_t i = 0; i < w.group.size(); i++) {
+        GLPoint pt = w.group[i];
+        for (long y = std::max(pt.y - 2, rect.top); y <= std::min(pt.y + 2, rect.bottom - 1); y++)
+            for (long x = std::max(pt.x - 2, rect.left); x <= std::min(pt.x + 2, rect.right - 1); x++) {
+                int& seen = w.labels[y * width + x];
+                if (seen < 0) seen = label, w.group.push_back({ x, y });
+            }
+    }
+}
+
+/* the cluster given by its cells in every phase of its period is split as apgsearch
+ * does: its cells of all phases are cut into islands of touching cells, and each
+ * part, at first an island, is stepped on its own from its cells of the first phase,
+ * it is an object if it repeats its cells of every phase of the cluster, else it is
+ * merged with the parts less than 3 cells apart from it and tried again, the whole
+ * cluster being the last resort, then every object is named with its own period
+ */
+inline std::vector<std::string> GLCensus::_split(const std::vector<std::vector<GLPoint>>& phases, const GLRule& rule) {
+    size_t period = phases.size();
+    GLRect box = { LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN };
+    for (auto& cells : phases)
+        for (auto& pt : cells) box.left = std::min(box.left, pt.x), box.top = std::min(box.top, pt.y), box.right = std::max(box.right, pt.x + 1), box.bottom = std::max(box.bottom, pt.y + 1);
+    size_t width = size_t(box.right - box.left + 4), height = size_t(box.bottom - box.top + 4);  //two dead cells around
+    auto at = [&](long x, long y) { return size_t(y - box.top + 2) * width + size_t(x - box.left + 2); };
+
+    std::vector<int> islands(width * height, -1);   //-1 dead, -2 alive and not labelled yet
+    std::vector<GLPoint> alive, stack;
+    for (auto& cells : phases)
+        for (auto& pt : cells)
+            if (islands[at(pt.x, pt.y)] == -1) islands[at(pt.x, pt.y)] = -2, alive.push_back(pt);
+    int count = 0;
+    for (auto& seed : alive) {
+        if (islands[at(seed.x, seed.y)] != -2) continue;
+        islands[at(seed.x, seed.y)] = count;
+        stack.assign(1, seed);
+        while (!stack.empty()) {
+            GLPoint pt = stack.back();
+            stack.pop_back();
+            for (long y = pt.y - 1; y <= pt.y + 1; y++)
+                for (long x = pt.x - 1; x <= pt.x + 1; x++)
+                    if (islands[at(x, y)] == -2) islands[at(x, y)] = count, stack.push_back({ x, y });
+        }
+        count++;
+    }
+
+    std::vector<int> owner(count);  //the part of every island, a part is known by its first island
+    for (int i = 0; i < count; i++) owner[i] = i;
+    auto part = [&](const GLPoint& pt) { return owner[islands[at(pt.x, pt.y)]]; };
+    GLBitMap trial(width, height);
+    trial.rule(rule);
+    auto independent = [&](int id) {
+        trial.init();
+        for (auto& pt : phases[0])
+            if (part(pt) == id) trial.set(size_t(pt.x - box.left + 2), size_t(pt.y - box.top + 2), true);
+        for (size_t p = 1; p <= period; p++) {
+            trial.next(false);
+            size_t cells = 0;
+            for (auto& pt : phases[p % period]) {
+                if (part(pt) != id) continue;
+                if (!trial.get(size_t(pt.x - box.left + 2), size_t(pt.y - box.top + 2))) return false;
+                cells++;
+            }
+            if (cells != trial.population()) return false;
+        }
+        return true;
+    };
+    std::vector<char> near(count);
+    auto merge = [&](int id) {  //a part less than 3 cells apart that completes this one, or all of them
+        std::fill(near.begin(), near.end(), 0);
+        for (auto& pt : alive) {
+            if (part(pt) != id) continue;
+            for (long y = pt.y - 2; y <= pt.y + 2; y++)
+                for (long x = pt.x - 2; x <= pt.x + 2; x++)
+                    if (islands[at(x, y)] >= 0 && owner[islands[at(x, y)]] != id) near[owner[islands[at(x, y)]]] = 1;
+        }
+        std::vector<int> before(owner);
+        for (int other = 0; other < count; other++) {
+            if (!near[other]) continue;
+            for (auto& own : owner) own = (own == other) ? id : own;
+            if (independent(id)) return 1;
+            owner = before;
+        }
+        int merged = 0;
+        for (int other = 0; other < count; other++) merged += near[other];
+        for (auto& own : owner) own = (near[own]) ? id : own;
+        return merged;
+    };
+    int parts = count;
+    for (int id = 0; id < count && parts > 1; id++) {
+        if (owner[id] != id) continue;
+        while (parts > 1 && !independent(id)) {
+            int merged = merge(id);
+            if (!merged) break;
+            parts -= merged;
+        }
+    }
+
+    std::vector<std::string> codes;
+    std::vector<std::vector<GLPoint>> object(period);
+    for (int id = 0; id < count; id++) {
+        if (owner[id] != id) continue;
+        for (size_t p = 0; p < period; p++) {
+            object[p].clear();
+            for (auto& pt : phases[p])
+                if (part(pt) == id) object[p].push_back(pt);
+        }
+        size_t own = 1;
+        while (own < period && (period % own || !_same(object[own], object[0]))) own++;
+        std::vector<std::vector<GLPoint>> cycle(object.begin(), object.begin() + own);
+        codes.push_back(apgcode(cycle, false));
+    }
+    return codes;
+}
+
+/* the group is tallied as a spaceship and erased if, stepped on its own, it becomes
+ * a copy of itself further from the middle of the arena
+ */
+inline bool GLCensus::_ship(Worker& w, GLBitMap& arena) const {
+    std::vector<GLPoint>& group = w.group;
+    GLRect box = { LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN };
+    for (auto& pt : group) box.left = std::min(box.left, pt.x), box.top = std::min(box.top, pt.y), box.right = std::max(box.right, pt.x + 1), box.bottom = std::max(box.bottom, pt.y + 1);
+    if (box.right - box.left > GLCS_SHIPBOX || box.bottom - box.top > GLCS_SHIPBOX) return false;
+
+    GLBitMap& scratch = w.scratch;
+    long room = GLCS_MAXSHIP / 2 + 2;   //spaceships are not faster than c/2
+    scratch.init();
+    for (auto& pt : group) scratch.set(size_t(pt.x - box.left + room), size_t(pt.y - box.top + room), true);
+    std::sort(group.begin(), group.end(), [](const GLPoint& a, const GLPoint& b) { return (a.y != b.y) ? a.y < b.y : a.x < b.x; });
+
+    GLRect all = { 0, 0, long(scratch.width()), long(scratch.height()) };
+    w.phases.assign(1, group);
+    for (size_t period = 1; period <= GLCS_MAXSHIP; period++) {
+        scratch.next(false);
+        std::vector<GLPoint>& cells = w.moved;
+        _alive(scratch, all, cells);
+        if (cells.empty()) return false;
+        if (cells.size() == group.size()) {
+            long dx = cells[0].x - room + box.left - group[0].x, dy = cells[0].y - room + box.top - group[0].y;
+            bool copy = true;
+            for (size_t i = 0; copy && i < cells.size(); i++) copy = cells[i].x - room + box.left - group[i].x == dx && cells[i].y - room + box.top - group[i].y == dy;
+            if (copy) {
+                long cx = (box.left + box.right) - long(arena.width()), cy = (box.top + box.bottom) - long(arena.height());
+                if (dx * cx + dy * cy <= 0) return false;   //an oscillator, or coming back
+                _record(w, w.phases, true);
+                for (auto& pt : group) arena.set(size_t(pt.x), size_t(pt.y), false);
+                return true;
+            }
+        }
+        w.phases.push_back(cells);
+    }
+    return false;
+}
+
+/* every group with cells in the band is tried as a spaceship, false if any of
+ * them is not one
+ */
+inline bool GLCensus::_ships(Worker& w, GLBitMap& arena, const GLRect& box) const {
+    long width = long(arena.width()), height = long(arena.height());
+    GLRect all = { 0, 0, width, height };
+    bool clear = true;
+    _alive(arena, box, w.cells);
+    for (auto& pt : w.cells) w.labels[pt.y * width + pt.x] = -1;
+    for (auto& pt : w.cells) {
+        bool band = pt.x < GLCS_BAND || pt.y < GLCS_BAND || pt.x >= width - GLCS_BAND || pt.y >= height - GLCS_BAND;
+        if (!band || w.labels[pt.y * width + pt.x] >= 0) continue;
+        w.seeds.assign(1, pt);
+        _group(w, size_t(width), 0, all);
+        clear &= _ship(w, arena);
+    }
+    for (auto& pt : w.cells) w.labels[pt.y * width + pt.x] = 0;
+    return clear;
+}
+
+/* the phases of a spaceship or a cluster are shifted to the origin, then the codes
+ * of its objects are looked up by its first phase before they are worked out
+ */
+inline void GLCensus::_record(Worker& w, std::vector<std::vector<GLPoint>>& phases, bool moving) const {
+    std::string key = (moving) ? "q" : "p";
+    key += std::to_string(phases.size());
+    long left = LONG_MAX, top = LONG_MAX;
+    for (auto& pt : phases[0]) left = std::min(left, pt.x), top = std::min(top, pt.y);
+    for (auto& pt : phases[0]) key += ' ' + std::to_string(pt.x - left) + ',' + std::to_string(pt.y - top);
+    auto it = w.codes.find(key);
+    if (it == w.codes.end()) it = w.codes.emplace(key, (moving) ? std::vector<std::string>(1, apgcode(phases, true)) : _split(phases, w.scratch.rule())).first;
+    for (auto& code : it->second) w.tally.objects[code]++;
+}
+
+/* the arena is stepped until it is the same again, within the generations given,
+ * false if it is not, else the cells alive in any phase are grouped into clusters,
+ * and the period of each cluster divides the one of the arena
+ */
+inline bool GLCensus::_objects(Worker& w, GLBitMap& arena, size_t gens) const {
+    size_t width = arena.width(), period = 0;
+    GLRect rect = { LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN }, box = {};
+    for (; period <= gens; period++) {
+        if (w.phases.size() <= period) w.phases.resize(period + 1);
+        if (arena.bounds(box)) _alive(arena, box, w.phases[period]);
+        else w.phases[period].clear();
+        if (period && _same(w.phases[period], w.phases[0])) break;
+        if (!w.phases[period].empty()) {
+            rect.left = std::min(rect.left, box.left), rect.top = std::min(rect.top, box.top);
+            rect.right = std::max(rect.right, box.right), rect.bottom = std::max(rect.bottom, box.bottom);
+        }
+        if (period < gens) arena.next(false);
+    }
+    if (period > gens) return false;
+    if (rect.left >= rect.right) return true;
+
+    for (size_t p = 0; p < period; p++)
+        for (auto& pt : w.phases[p]) w.labels[pt.y * width + pt.x] = -1;
+    int objects = 0;
+    for (size_t p = 0; p < period; p++)
+        for (auto& pt : w.phases[p]) {
+            if (w.labels[pt.y * width + pt.x] >= 0) continue;
+            w.seeds.assign(1, pt);
+            _group(w, width, objects++, rect);
+        }
+
+    if (w.objects.size() < size_t(objects)) w.objects.resize(objects);
+    for (int i = 0; i < objects; i++) {
+        w.objects[i].resize(period);
+        for (auto& cells : w.objects[i]) cells.clear();
+    }
+    for (size_t p = 0; p < period; p++)
+        for (auto& pt : w.phases[p]) w.objects[w.labels[pt.y * width + pt.x]][p].push_back(pt);
+    for (size_t p = 0; p < period; p++)
+        for (auto& pt : w.phases[p]) w.labels[pt.y * width + pt.x] = 0;
+
+    for (int i = 0; i < objects; i++) {
+        std::vector<std::vector<GLPoint>>& phases = w.objects[i];
+        size_t own = 1;
+        while (own < period && (period % own || !_same(phases[own], phases[0]))) own++;
+        phases.resize(own);
+        _record(w, phases, false);
+    }
+    return true;
+}
+
+inline void GLCensus::_soup(Worker& w, unsigned seed, float ratio, size_t gens) const {
+    GLBitMap* arena = &_arena(w, _side(long(_width)), _side(long(_height)));
+    long aw = long(arena->width()), ah = long(arena->height());
+    size_t looks = 0;
+    arena->init();
+    GLSoup soup(ratio, seed);   //the same soup as GLMap::init() of a map of the soup size
+    w.words.resize((_width + GLB_WORDBITS - 1) / GLB_WORDBITS);
+    for (size_t y = 0; y < _height; y++) {
+        soup.row(y, w.words.data(), _width);
+        for (size_t k = 0; k < w.words.size(); k++)
+            for (uint64_t word = w.words[k]; word; word &= word - 1) arena->set((aw - _width) / 2 + k * GLB_WORDBITS + ctz64(word), (ah - _height) / 2 + y, true);
+    }
+    w.tally.soups++;
+
+    GLRect box;
+    auto move = [&](size_t width, size_t height) {  //to the middle of an arena
+        long dx = (long(width) - (box.right - box.left)) / 2 - box.left, dy = (long(height) - (box.bottom - box.top)) / 2 - box.top;
+        size_t gen = arena->gen();
+        _alive(*arena, box, w.cells);
+        GLBitMap& next = _arena(w, width, height);
+        next.init();
+        for (auto& pt : w.cells) next.set(size_t(pt.x + dx), size_t(pt.y + dy), true);
+        next.gen(gen);
+        arena = &next;
+        aw = long(width), ah = long(height);
+        looks = 0;
+    };
+    while (arena->gen() < gens) {
+        for (size_t k = std::min<size_t>(GLCS_CHECK, gens - arena->gen()); k > 0; k--) arena->next(false);
+        uint64_t hash;
+        if (!arena->bounds(box, hash)) break;   //died out
+        bool inner = box.left >= GLCS_BAND && box.top >= GLCS_BAND && box.right <= aw - GLCS_BAND && box.bottom <= ah - GLCS_BAND;
+        if (!inner && !_ships(w, *arena, box)) {
+            size_t width = std::max(_side(box.right - box.left), size_t(aw)), height = std::max(_side(box.bottom - box.top), size_t(ah));
+            if (arena->bounds(box)) {
+                move(width, height);    //larger, or only the middle of the same one
+                continue;
+            }
+        }
+        if (!inner && !arena->bounds(box, hash)) break;
+        size_t width = _side(box.right - box.left), height = _side(box.bottom - box.top);
+        if (width + 2 * GLCS_ALIGN <= size_t(aw) || height + 2 * GLCS_ALIGN <= size_t(ah)) {
+            move(std::min(width, size_t(aw)), std::min(height, size_t(ah)));   //once the spaceships are gone
+            continue;
+        }
+        if (box.left == 0 || box.top == 0 || box.right == aw || box.bottom == ah) {
+            w.tally.spilled++;
+            w.tally.gens += arena->gen();
+            return;
+        }
+
+        for (size_t k = 1; k <= std::min<size_t>(looks, GLCS_SAMPLES - 1); k++) {
+            if (w.hashes[(looks - k) % GLCS_SAMPLES] != hash) continue;
+            if (_objects(w, *arena, k * GLCS_CHECK)) {
+                w.tally.settled++;
+                w.tally.gens += arena->gen();
+                return;
+            }
+            break;  //a collision of the hash
+        }
+        w.hashes[looks++ % GLCS_SAMPLES] = hash;
+    }
+    w.tally.gens += arena->gen();
+    if (arena->population()) return;    //still running
+    w.tally.settled++;
+}
@@ -0,0 +1,457 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "glmap.h"
+#include "glpattern.h"
+#include "glsnapshot.h"
+
+
+#define GLDM_ALIGN      64      //the columns are split at multiples of it, so every domain packs whole words
+#define GLDM_CACHELINE  64      //the parts of the shared memory are aligned to it
+#define GLDM_POLL       200     //microseconds between two looks of a process waiting for the others
+
+
+/* a rectangle of a larger map, held in a padded GLMap of its own size:
+ * width() and height() are the ones of the whole map, and the cells are written
+ * in the coordinates of the whole map, the ones outside the rectangle are dropped,
+ * so a pattern is loaded into every domain as into the whole map
+ */
+class GLDomain {
+public:
+    GLDomain(size_t width, size_t height, const GLRect& rect)
+        :_width(width), _height(height), _rect(rect), _map(size_t(rect.right - rect.left), size_t(rect.bottom - rect.top)) { _map.layout(GLM_PADDED); }
+    GLDomain(const GLDomain&) = delete;
+    GLDomain(GLDomain&&) = delete;
+
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    const GLRect& rect() const { return _rect; }
+    GLMap& map() { return _map; }
+    const GLMap& map() const { return _map; }
+    size_t gen() const { return _map.gen(); }
+    void gen(size_t gen) { _map.gen(gen); }
+    const GLRule& rule() const { return _map.rule(); }
+    void rule(const GLRule& rule) { _map.rule(rule); }
+    bool inside(size_t x, size_t y) const { return long(x) >= _rect.left && long(x) < _rect.right && long(y) >= _rect.top && long(y) < _rect.bottom; }
+
+    void init() { _map.init(); }
+    void init(float ratio, unsigned seed = std::minstd_rand::default_seed);
+    void set(size_t x, size_t y, bool alive) { if (inside(x, y)) _map[y - _rect.top][x - _rect.left] = alive; }
+    void touch() { _map.touch(); }
+
+private:
+    size_t _width, _height;
+    GLRect _rect;
+    GLMap _map;
+};
+
+/* the same soup as GLMap::init() on the whole map */
+inline void GLDomain::init(float ratio, unsigned seed /*std::minstd_rand::default_seed*/) {
+    _map.init();
+    GLSoup soup(ratio, seed);
+    for (size_t y = 0; y < _map.height(); y++) soup.row(_rect.top + y, _map[y], _map.width(), _rect.left);
+    _map.touch();
+}
+
+/* the runs are clipped to the rectangle of the domain */
+template<>
+struct GLSink<GLDomain> {
+    GLDomain& map;
+
+    void begin() { map.init(); }
+    void run(size_t x, size_t y, size_t len);
+    void bits(size_t x, size_t y, uint64_t word, size_t len);
+    void end() { map.touch(); }
+};
+
+inline void GLSink<GLDomain>::run(size_t x, size_t y, size_t len) {
+    const GLRect& rect = map.rect();
+    if (long(y) < rect.top || long(y) >= rect.bottom) return;
+    long left = std::max(long(x), rect.left), right = std::min(long(x + len), rect.right);
+    if (left < right) memset(&map.map()[y - rect.top][left - rect.left], true, sizeof(bool) * (right - left));
+}
+
+inline void GLSink<GLDomain>::bits(size_t x, size_t y, uint64_t word, size_t len) {
+    const GLRect& rect = map.rect();
+    if (long(y) < rect.top || long(y) >= rect.bottom || long(x + len) <= rect.left || long(x) >= rect.right) return;
+    if (long(x) >= rect.left && long(x + len) <= rect.right) return unpackWord(word, len, &map.map()[y - rect.top][x - rect.left]);
+    for (size_t i = 0; i < len; i++, word >>= 1) map.set(x + i, y, word & 1);
+}
+
+
+/* a map split into cols x rows domains, each stepped by a worker process:
+ * run() forks one worker per domain, which loads its domain and steps it in a
+ * padded GLMap, with the threads set by load(), before every generation the
+ * workers publish the outer rows and columns of their domains to POSIX shared
+ * memory, wait on a process-shared barrier, and fill their halos from the ones
+ * of their 8 neighbours, wrapping around the whole map when boundless,
+ * the edges are published in two slots by the parity of the generation, so a
+ * single barrier per generation keeps a worker from overwriting the edges its
+ * neighbours are still reading,
+ * the columns are split at multiples of GLDM_ALIGN, and the rows evenly, so there
+ * are at most width / GLDM_ALIGN columns and height rows of domains
+ *
+ * every interval generations and after the last one, the workers pack their cells
+ * into a shared frame of the whole map, 64 cells per word as in GLBitMap, and
+ * frame() assembles it in the coordinator, while the workers carry on until the
+ * next frame, the coordinator watches the workers and stops all of them if one
+ * of them fails or dies, since the others would wait for it forever
+ */
+class GLDomains {
+public:
+    GLDomains(size_t width, size_t height, size_t cols, size_t rows);
+    GLDomains(const GLDomains&) = delete;
+    GLDomains(GLDomains&&) = delete;
+    ~GLDomains() { _unmap(); }
+
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    size_t cols() const { return _cols; }
+    size_t rows() const { return _rows; }
+    size_t size() const { return _cols * _rows; }
+    GLRect rect(size_t i) const { return { long(_xs[i % _cols]), long(_ys[i / _cols]), long(_xs[i % _cols + 1]), long(_ys[i / _cols + 1]) }; }
+    size_t gen() const { return _gen; }
+    const GLRule& rule() const { return _rule; }
+    size_t population() const;
+    bool bounds(GLRect& rect) const;
+    double loading() const;     //of the slowest worker
+    double seconds() const;     //stepping, of the slowest worker
+    size_t memory() const { return _size; }     //of the shared memory
+    const std::string& error() const { return _error; }
+    void words(size_t y, uint64_t* dst) const { memcpy(dst, _frame + y * _words, sizeof(uint64_t) * _words); }    //inside frame()
+
+    bool run(size_t gens, bool boundless, const std::function<bool(GLDomain&)>& load, size_t interval = 0, const std::function<void(const GLDomains&)>& frame = nullptr);
+
+private:
+    struct Shared {
+        pthread_barrier_t step;     //of the workers, once per generation
+        std::atomic<uint32_t> loaded, failed;
+        std::atomic<bool> go;       //all domains are loaded
+        std::atomic<uint64_t> packed, released;     //domains packed into the frame, frames assembled
+        GLRule rule;
+        uint64_t first;     //the generation loaded
+    };
+    struct Result {
+        uint64_t gen, population;
+        GLRect bbox;    //in the coordinates of the whole map, empty if left >= right
+        double loading, seconds;
+    };
+    struct Edges { const bool* top, * bottom, * left, * right; };
+
+    size_t _width, _height, _cols, _rows, _words;
+    std::vector<size_t> _xs, _ys;   //the bounds of the columns and the rows of domains
+    std::vector<size_t> _slots;     //offset of the edges of every domain
+    std::vector<Result> _results;
+    size_t _gen = 0;
+    GLRule _rule = GLR_CONWAY;
+    std::string _error;
+    char* _base = nullptr;
+    size_t _size = 0;
+    Shared* _shared = nullptr;
+    Result* _shresults = nullptr;
+    uint64_t* _frame = nullptr;
+
+    static size_t _align(size_t size) { return (size + GLDM_CACHELINE - 1) / GLDM_CACHELINE * GLDM_CACHELINE; }
+    bool* _edges(size_t i, size_t parity) const;
+    Edges _neighbour(size_t i, long dc, long dr, size_t parity, bool boundless) const;
+    bool _map(size_t frames);
+    void _unmap();
+    void _exchange(size_t i, GLMap& map, bool boundless);
+    void _pack(size_t i, const GLMap& map);
+    int _work(size_t i, size_t gens, bool boundless, const std::function<bool(GLDomain&)>& load, size_t chunk, bool frames);
+    bool _watch(const std::vector<pid_t>& pids, const std::function<bool()>& ready);
+    static void _stop(const std::vector<pid_t>& pids);
+};
+
+inline GLDomains::GLDomains(size_t width, size_t height, size_t cols, size_t rows)
+    :_width(width), _height(height), _cols(std::min(std::max<size_t>(cols, 1), std::max<size_t>(width / GLDM_ALIGN, 1))),
+    _rows(std::min(std::max<size_t>(rows, 1), height)), _words((width + GLB_WORDBITS - 1) / GLB_WORDBITS) {
+    for (size_t c = 0; c < _cols; c++) _xs.push_back(width * c / _cols / GLDM_ALIGN * GLDM_ALIGN);
+    for (size_t r = 0; r < _rows; r++) _ys.push_back(height * r / _rows);
+    _xs.push_back(width);
+    _ys.push_back(height);
+}
+
+inline size_t GLDomains::population() const {
+    size_t population = 0;
+    for (auto& result : _results) population += result.population;
+    return population;
+}
+
+inline bool GLDomains::bounds(GLRect& rect) const {
+    rect = { long(_width), long(_height), 0, 0 };
+    for (auto& result : _results) {
+        if (result.bbox.left >= result.bbox.right) continue;
+        rect.left = std::min(rect.left, result.bbox.left), rect.top = std::min(rect.top, result.bbox.top);
+        rect.right = std::max(rect.right, result.bbox.right), rect.bottom = std::max(rect.bottom, result.bbox.bottom);
+    }
+    return rect.left < rect.right;
+}
+
+inline double GLDomains::loading() const {
+    double seconds = 0;
+    for (auto& result : _results) seconds = std::max(seconds, result.loading);
+    return seconds;
+}
+
+inline double GLDomains::seconds() const {
+    double seconds = 0;
+    for (auto& result : _results) seconds = std::max(seconds, result.seconds);
+    return seconds;
+}
+
+/* the top and bottom rows, then the left and right columns, of a domain */
+inline bool* GLDomains::_edges(size_t i, size_t parity) const {
+    GLRect r = rect(i);
+    return (bool*)_base + _slots[i] + parity * 2 * size_t(r.right - r.left + r.bottom - r.top);
+}
+
+/* none outside the map unless boundless */
+inline GLDomains::Edges GLDomains::_neighbour(size_t i, long dc, long dr, size_t parity, bool boundless) const {
+    long c = long(i % _cols) + dc, r = long(i / _cols) + dr;
+    if (!boundless && (c < 0 || c >= long(_cols) || r < 0 || r >= long(_rows))) return { nullptr, nullptr, nullptr, nullptr };
+    size_t j = size_t((r + long(_rows)) % long(_rows)) * _cols + size_t((c + long(_cols)) % long(_cols));
+    GLRect n = rect(j);
+    size_t w = size_t(n.right - n.left), h = size_t(n.bottom - n.top);
+    const bool* edges = _edges(j, parity);
+    return { edges, edges + w, edges + 2 * w, edges + 2 * w + h };
+}
+
+/* unlinked as soon as it is mapped, so it never outlives the processes */
+inline bool GLDomains::_map(size_t frames) {
+    _slots.clear();
+    size_t bytes = _align(sizeof(Shared)) + _align(sizeof(Result) * size());
+    for (size_t i = 0; i < size(); i++) {
+        GLRect r = rect(i);
+        _slots.push_back(bytes);
+        bytes += _align(2 * 2 * size_t(r.right - r.left + r.bottom - r.top));
+    }
+    size_t offset = bytes;
+    bytes += frames * _height * _words * sizeof(uint64_t);
+
+    std::string name = "/gldomains." + std::to_string(getpid());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return false;
+    void* base = (ftruncate(fd, off_t(bytes)) == 0) ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    shm_unlink(name.c_str());
+    if (base == MAP_FAILED) return false;
+
+    _base = (char*)base;
+    _size = bytes;
+    _shared = new (_base) Shared();
+    _shresults = (Result*)(_base + _align(sizeof(Shared)));
+    _frame = (frames) ? (uint64_t*)(_base + offset) : nullptr;
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    bool ok = pthread_barrier_init(&_shared->step, &attr, unsigned(size())) == 0;
+    pthread_barrierattr_destroy(&attr);
+    if (!ok) _unmap();
+    return ok;
+}
+
+inline void GLDomains::_unmap() {
+    if (!_base) return;
+    pthread_barrier_destroy(&_shared->step);
+    _shared->~Shared();
+    munmap(_base, _size);
+    _base = nullptr;
+    _shared = nullptr;
+    _shresults = nullptr;
+    _frame = nullptr;
+}
+
+/* the halo of a domain from the edges of its neighbours, the corners from the
+ * diagonal ones, and dead cells where there are none
+ */
+inline void GLDomains::_exchange(size_t i, GLMap& map, bool boundless) {
+    size_t w = map.width(), h = map.height(), parity = map.gen() & 1;
+    bool* out = _edges(i, parity);
+    memcpy(out, map[0], sizeof(bool) * w);
+    memcpy(out + w, map[h - 1], sizeof(bool) * w);
+    for (size_t y = 0; y < h; y++) out[2 * w + y] = map[y][0], out[2 * w + h + y] = map[y][w - 1];
+    pthread_barrier_wait(&_shared->step);
+
+    auto width = [this, i](long dc) {   //of the column of domains of a neighbour
+        long c = (long(i % _cols) + dc + long(_cols)) % long(_cols);
+        return _xs[c + 1] - _xs[c];
+    };
+    Edges n = _neighbour(i, 0, -1, parity, boundless), s = _neighbour(i, 0, 1, parity, boundless);
+    Edges west = _neighbour(i, -1, 0, parity, boundless), east = _neighbour(i, 1, 0, parity, boundless);
+    Edges nw = _neighbour(i, -1, -1, parity, boundless), ne = _neighbour(i, 1, -1, parity, boundless);
+    Edges sw = _neighbour(i, -1, 1, parity, boundless), se = _neighbour(i, 1, 1, parity, boundless);
+    bool* top = map.halo(-1), * bottom = map.halo(long(h));
+    if (n.bottom) memcpy(top, n.bottom, sizeof(bool) * w);
+    else memset(top, 0, sizeof(bool) * w);
+    if (s.top) memcpy(bottom, s.top, sizeof(bool) * w);
+    else memset(bottom, 0, sizeof(bool) * w);
+    for (size_t y = 0; y < h; y++) {
+        bool* row = map.halo(long(y));
+        row[-1] = west.right && west.right[y];
+        row[w] = east.left && east.left[y];
+    }
+    top[-1] = nw.bottom && nw.bottom[width(-1) - 1];
+    top[w] = ne.bottom && ne.bottom[0];
+    bottom[-1] = sw.top && sw.top[width(-1) - 1];
+    bottom[w] = se.top && se.top[0];
+}
+
+inline void GLDomains::_pack(size_t i, const GLMap& map) {
+    GLRect r = rect(i);
+    for (size_t y = 0; y < map.height(); y++) {
+        uint64_t* dst = _frame + (r.top + y) * _words + r.left / GLB_WORDBITS;
+        for (size_t x = 0; x < map.width(); x += GLB_WORDBITS) *dst++ = packWord(map[y] + x, std::min<size_t>(GLB_WORDBITS, map.width() - x));
+    }
+}
+
+/* the body of a worker process, which waits for all domains to be loaded before
+ * stepping, and for the previous frame to be assembled before packing the next one
+ */
+inline int GLDomains::_work(size_t i, size_t gens, bool boundless, const std::function<bool(GLDomain&)>& load, size_t chunk, bool frames) {
+    using clock = std::chrono::steady_clock;
+    auto poll = []() { std::this_thread::sleep_for(std::chrono::microseconds(GLDM_POLL)); };
+
+    std::unique_ptr<GLDomain> domain;
+    Result& result = _shresults[i];
+    try {
+        auto start = clock::now();
+        domain.reset(new GLDomain(_width, _height, rect(i)));
+        if (!load(*domain)) throw std::runtime_error("load");
+        result.loading = std::chrono::duration<double>(clock::now() - start).count();
+    } catch (std::exception&) {
+        _shared->failed++;
+        return 1;
+    }
+    GLMap& map = domain->map();
+    map.layout(GLM_PADDED);
+    map.tiles(false);
+    map.cycles(GLM_CYCLEOFF);
+    map.exchange([this, i, boundless](GLMap& sub) { _exchange(i, sub, boundless); });
+    if (i == 0) _shared->rule = map.rule(), _shared->first = map.gen();
+    _shared->loaded++;
+    while (!_shared->go) {
+        if (_shared->failed) return 1;
+        poll();
+    }
+
+    auto start = clock::now();
+    size_t nframes = 0;
+    for (size_t done = 0; done < gens; done += chunk) {
+        map.next(boundless, std::min(chunk, gens - done));
+        if (!frames) continue;
+        while (_shared->released < nframes) poll();
+        _pack(i, map);
+        _shared->packed++;
+        nframes++;
+    }
+    result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    while (_shared->released < nframes) poll();     //exiting before would look like a failure
+    result.gen = map.gen();
+    result.population = map.population();
+    GLRect bbox;
+    if (map.bounds(bbox)) result.bbox = { bbox.left + rect(i).left, bbox.top + rect(i).top, bbox.right + rect(i).left, bbox.bottom + rect(i).top };
+    else result.bbox = {};
+    return 0;
+}
+
+/* false once a worker failed or exited before */
+inline bool GLDomains::_watch(const std::vector<pid_t>& pids, const std::function<bool()>& ready) {
+    while (!ready()) {
+        if (_shared->failed) return false;
+        for (pid_t pid : pids)
+            if (waitpid(pid, nullptr, WNOHANG) != 0) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(GLDM_POLL));
+    }
+    return true;
+}
+
+inline void GLDomains::_stop(const std::vector<pid_t>& pids) {
+    for (pid_t pid : pids) kill(pid, SIGKILL);
+    for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+}
+
+/* the workers are forked from the calling process, which should not be running
+ * other threads, and the frames follow the chunks of the snapshots of glheadless
+ */
+inline bool GLDomains::run(size_t gens, bool boundless, const std::function<bool(GLDomain&)>& load, size_t interval /*0*/, const std::function<void(const GLDomains&)>& frame /*nullptr*/) {
+    _unmap();
+    _results.clear();
+    _error.clear();
+    if (!_map(frame != nullptr)) {
+        _error = "unable to map shared memory";
+        return false;
+    }
+
+    size_t chunk = (frame && interval) ? interval : std::max<size_t>(gens, 1);
+    std::vector<pid_t> pids;
+    for (size_t i = 0; i < size(); i++) {
+        pid_t pid = fork();
+        if (pid == 0) _exit(_work(i, gens, boundless, load, chunk, frame != nullptr));
+        if (pid < 0) {
+            _stop(pids);
+            _unmap();
+            _error = "unable to fork a worker";
+            return false;
+        }
+        pids.push_back(pid);
+    }
+
+    bool ok = _watch(pids, [this]() { return _shared->loaded == size(); });
+    if (!ok) _error = "unable to load a domain";
+    _rule = _shared->rule;
+    _gen = size_t(_shared->first);
+    _shared->go = true;
+
+    for (size_t done = 0, nframes = 0; ok && frame && done < gens; done += chunk) {
+        ok = _watch(pids, [this, nframes]() { return _shared->packed == (nframes + 1) * size(); });
+        if (!ok) {
+            _error = "a worker stopped";
+            break;
+        }
+        _gen = size_t(_shared->first) + std::min(done + chunk, gens);
+        frame(*this);
+        _shared->released = ++nframes;
+    }
+
+    if (!ok) _stop(pids);
+    for (pid_t pid : pids) {
+        int status = 0;
+        if (ok && (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status))) ok = false, _error = "a worker stopped";
+    }
+    if (ok) _results.assign(_shresults, _shresults + size());
+    if (ok) _gen = size_t(_results.front().gen);
+    _unmap();
+    return ok;
+}
+
+inline bool saveSnapshot(std::ostream& out, const GLDomains& domains, bool boundless) {
+    GLSnapshot snap = { domains.width(), domains.height(), domains.gen(), boundless, domains.rule() };
+    return writeSnapshot(out, snap, [&domains](size_t y, uint64_t* dst) { domains.words(y, dst); });
+}
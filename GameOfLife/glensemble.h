@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "glmap.h"
+#include "glpool.h"
+
+
+/* a random map of an ensemble, and what became of it */
+struct GLRun {
+    unsigned seed;
+    float ratio;
+    size_t gen = 0, population = 0;
+    size_t period = 0, entry = 0;   //the cycle found by the map, period 0 for none
+    double seconds = 0;     //spent on the soup and the generations
+};
+
+/* many independent random maps of the same size, stepped concurrently:
+ * each run takes a whole map on one thread of the pool, so the threads never
+ * wait for each other, and the maps are taken from a free list and refilled by
+ * init(), so their buffers are only allocated once per thread that needs one
+ */
+class GLEnsemble {
+public:
+    GLEnsemble(size_t width, size_t height, size_t nthreads) :_width(width), _height(height), _pool(nthreads) {}
+    GLEnsemble(const GLEnsemble&) = delete;
+    GLEnsemble(GLEnsemble&&) = delete;
+
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    size_t threads() const { return _pool.size(); }
+    size_t maps() const { return _maps.size(); }
+    void setup(const std::function<void(GLMap&)>& setup) { _setup = setup; _maps.clear(); _free.clear(); }
+
+    void run(std::vector<GLRun>& runs, size_t gens, bool boundless);
+
+private:
+    size_t _width, _height;
+    GLPool _pool;
+    std::function<void(GLMap&)> _setup;     //applied once to every new map
+    std::vector<std::unique_ptr<GLMap>> _maps;
+    std::vector<GLMap*> _free;  //maps not taken by a run
+    std::mutex _mtx;
+
+    GLMap* _acquire();
+    void _release(GLMap* map);
+};
+
+/* a new map is allocated and set up outside the lock */
+inline GLMap* GLEnsemble::_acquire() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (!_free.empty()) {
+            GLMap* map = _free.back();
+            _free.pop_back();
+            return map;
+        }
+    }
+    std::unique_ptr<GLMap> map(new GLMap(_width, _height));
+    if (_setup) _setup(*map);
+    std::lock_guard<std::mutex> lock(_mtx);
+    _maps.push_back(std::move(map));
+    return _maps.back().get();
+}
+
+inline void GLEnsemble::_release(GLMap* map) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _free.push_back(map);
+}
+
+/* the runs are taken in order by whichever thread is free, and filled in place */
+inline void GLEnsemble::run(std::vector<GLRun>& runs, size_t gens, bool boundless) {
+    using clock = std::chrono::steady_clock;
+    std::function<void(size_t)> task = [this, &runs, gens, boundless](size_t i) {
+        GLRun& run = runs[i];
+        GLMap* map = _acquire();
+        auto start = clock::now();
+        map->init(run.ratio, run.seed);
+        map->next(boundless, gens);
+        run.seconds = std::chrono::duration<double>(clock::now() - start).count();
+        run.gen = map->gen();
+        run.population = map->population();
+        run.period = map->period();
+        run.entry = map->entry();
+        _release(map);
+    };
+    _pool.run(runs.size(), task);
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "glmap.h"
+#include "glsimd.h"
+#include "glsnapshot.h"
+#include "glrender.h"
+
+
+#define GLX_PPM         0   //binary PPM files
+#define GLX_PNG         1   //PNG files, stored without compression
+#define GLX_RAW         2   //RGB24 frames back to back on a stream
+
+#define GLX_DEPTH       3   //frames in flight between two stages
+#define GLX_DIGITS      8   //of the generation in the file names
+#define GLX_STORED      65535   //bytes of a stored deflate block
+#define GLX_ADLERRUN    5552    //bytes summed by adler-32 before a modulo
+
+/* the scales and colours of the window, as 0x00RRGGBB */
+#define GLX_DEFSCALE    5
+#define GLX_MINSCALE    1
+#define GLX_MAXSCALE    10
+
+#define GLX_COLBLANK    0x000000u
+#define GLX_COLCELL     0xFFFFFFu
+#define GLX_COLBARRIER  0xFFFF00u
+#define GLX_COLBORDER   0x0000FFu
+#define GLX_COLBOUNDS   0xFF0000u
+
+
+/* bounded blocking queue between two threads, closed by the producer */
+template<class T>
+class GLQueue {
+public:
+    explicit GLQueue(size_t capacity) :_capacity(capacity) {}
+
+    bool push(T&& item);
+    bool pop(T& item);
+    void close();
+
+private:
+    std::deque<T> _items;
+    size_t _capacity;
+    bool _closed = false;
+    std::mutex _mtx;
+    std::condition_variable _cvpush, _cvpop;
+};
+
+template<class T>
+bool GLQueue<T>::push(T&& item) {
+    std::unique_lock<std::mutex> lock(_mtx);
+    _cvpush.wait(lock, [this]() { return _closed || _items.size() < _capacity; });
+    if (_closed) return false;
+    _items.push_back(std::move(item));
+    _cvpop.notify_one();
+    return true;
+}
+
+template<class T>
+bool GLQueue<T>::pop(T& item) {
+    std::unique_lock<std::mutex> lock(_mtx);
+    _cvpop.wait(lock, [this]() { return _closed || !_items.empty(); });
+    if (_items.empty()) return false;
+    item = std::move(_items.front());
+    _items.pop_front();
+    _cvpush.notify_one();
+    return true;
+}
+
+template<class T>
+void GLQueue<T>::close() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _closed = true;
+    _cvpush.notify_all();
+    _cvpop.notify_all();
+}
+
+/* exports generations of a map as images drawn as in the window:
+ * push() only packs the cells as bits, a render thread unpacks them a row at a
+ * time and paints them on a persistent canvas, so only the cells changed since
+ * the previous frame are painted, and a
+ * writer thread encodes and writes the images, the buffers go round between the
+ * stages, and push() only waits once GLX_DEPTH frames are waiting to be rendered,
+ * a '#' in the file name is replaced by the generation, or it is put before the
+ * extension, and the raw format writes to the stream given instead
+ */
+class GLExporter {
+public:
+    GLExporter(const std::string& fname, int format, int scale, const GLPalette& palette, std::ostream* stream = nullptr);
+    GLExporter(const GLExporter&) = delete;
+    GLExporter(GLExporter&&) = delete;
+    ~GLExporter() { finish(); }
+
+    size_t frames() const { return _frames; }
+    size_t width() const { return _canvas.width(); }
+    size_t height() const { return _canvas.height(); }
+    double rendering() const { return _rendering; }     //seconds spent by each stage
+    double writing() const { return _writing; }
+    bool failed() const { return _failed; }
+
+    void push(const GLMap& map);
+    void finish();
+
+private:
+    struct Frame {
+        size_t gen = 0, width = 0, height = 0;
+        std::vector<uint64_t> words;    //cells, row by row
+        std::vector<char> data;         //RGB24 pixels
+    };
+
+    std::string _fname;
+    int _format, _scale;
+    GLPalette _palette;
+    std::ostream* _stream;
+    GLRowPack _pack = rowPack(detectKernel());
+    GLCanvas _canvas;
+    GLQueue<Frame> _cells, _freecells, _images, _freeimages;
+    std::thread _renderer, _writer;
+    bool _finished = false;
+    size_t _frames = 0;
+    double _rendering = 0, _writing = 0;
+    std::atomic<bool> _failed{ false };
+
+    void _render();
+    void _write();
+    std::string _name(size_t gen) const;
+    static uint32_t _crc(uint32_t crc, const char* data, size_t len);
+    bool _png(std::ostream& out, const Frame& image) const;
+};
+
+inline GLExporter::GLExporter(const std::string& fname, int format, int scale, const GLPalette& palette, std::ostream* stream /*nullptr*/)
+    :_fname(fname), _format(format), _scale(scale), _palette(palette), _stream(stream),
+    _cells(GLX_DEPTH), _freecells(GLX_DEPTH), _images(GLX_DEPTH), _freeimages(GLX_DEPTH) {
+    for (int i = 0; i < GLX_DEPTH; i++) _freecells.push(Frame()), _freeimages.push(Frame());
+    _renderer = std::thread(&GLExporter::_render, this);
+    _writer = std::thread(&GLExporter::_write, this);
+}
+
+inline void GLExporter::push(const GLMap& map) {
+    Frame frame;
+    if (_finished || !_freecells.pop(frame)) return;
+    frame.gen = map.gen();
+    frame.width = map.width();
+    frame.height = map.height();
+    size_t nwords = (frame.width + GLB_WORDBITS - 1) / GLB_WORDBITS;
+    frame.words.resize(nwords * frame.height);
+    for (size_t y = 0; y < frame.height; y++) _pack(map[y], frame.width, &frame.words[y * nwords]);
+    _cells.push(std::move(frame));
+    _frames++;
+}
+
+/* the frames pushed are all written before it returns */
+inline void GLExporter::finish() {
+    if (_finished) return;
+    _finished = true;
+    _cells.close();
+    _renderer.join();
+    _images.close();
+    _writer.join();
+}
+
+inline void GLExporter::_render() {
+    using clock = std::chrono::steady_clock;
+    Frame cells, image;
+    std::vector<char> row;
+    while (_cells.pop(cells)) {
+        auto start = clock::now();
+        _freeimages.pop(image);
+        size_t width = (cells.width + 2) * _scale, height = (cells.height + 2) * _scale;
+        _canvas.resize(width, height);
+        size_t nwords = (cells.width + GLB_WORDBITS - 1) / GLB_WORDBITS;
+        row.resize(nwords * GLB_WORDBITS);
+        auto rows = [&](size_t y, size_t x) {
+            for (size_t w = 0; w < nwords; w++) unpackWord(cells.words[y * nwords + w], GLB_WORDBITS, (bool*)&row[w * GLB_WORDBITS]);
+            return &row[x];
+        };
+        _canvas.render(cells.width, cells.height, rows, 0, 0, _scale, _palette);
+
+        image.gen = cells.gen;
+        image.width = width;
+        image.height = height;
+        image.data.resize(width * height * 3);
+        const uint32_t* pixels = _canvas.pixels();
+        char* rgb = image.data.data();
+        for (size_t i = 0; i < width * height; i++, rgb += 3) {
+            rgb[0] = char(pixels[i] >> 16);
+            rgb[1] = char(pixels[i] >> 8);
+            rgb[2] = char(pixels[i]);
+        }
+        _rendering += std::chrono::duration<double>(clock::now() - start).count();
+        _freecells.push(std::move(cells));
+        _images.push(std::move(image));
+    }
+}
+
+inline void GLExporter::_write() {
+    using clock = std::chrono::steady_clock;
+    Frame image;
+    while (_images.pop(image)) {
+        auto start = clock::now();
+        bool written = false;
+        if (_format == GLX_RAW) {
+            written = _stream && _stream->write(image.data.data(), image.data.size());
+        } else {
+            std::ofstream file(_name(image.gen), std::ios::binary);
+            if (_format == GLX_PNG) {
+                written = file.is_open() && _png(file, image);
+            } else {
+                file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+                written = file.is_open() && file.write(image.data.data(), image.data.size());
+            }
+            written = written && file.flush();
+        }
+        if (!written) _failed = true;
+        _writing += std::chrono::duration<double>(clock::now() - start).count();
+        _freeimages.push(std::move(image));
+    }
+    if (_stream) _stream->flush();
+}
+
+inline std::string GLExporter::_name(size_t gen) const {
+    char digits[32];
+    std::snprintf(digits, sizeof(digits), "%0*zu", GLX_DIGITS, gen);
+    std::string name = _fname;
+    size_t pos = name.find('#');
+    if (pos != name.npos) return name.replace(pos, 1, digits);
+    size_t dot = name.rfind('.'), slash = name.find_last_of("/\\");
+    if (dot == name.npos || (slash != name.npos && dot < slash)) dot = name.size();
+    return name.insert(dot, std::string("-") + digits);
+}
+
+/* crc-32 of PNG, 8 bytes at a time with 8 tables */
+inline uint32_t GLExporter::_crc(uint32_t crc, const char* data, size_t len) {
+    static const struct Tables {
+        uint32_t t[8][256];
+        Tables() {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[0][n] = c;
+            }
+            for (uint32_t n = 0; n < 256; n++)
+                for (int k = 1; k < 8; k++) t[k][n] = t[0][t[k - 1][n] & 0xFF] ^ (t[k - 1][n] >> 8);
+        }
+    } tables;
+    const uint32_t (*t)[256] = tables.t;
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    for (; len >= 8; len -= 8, p += 8) {
+        uint32_t lo = crc ^ (uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);
+        uint32_t hi = uint32_t(p[4]) | uint32_t(p[5]) << 8 | uint32_t(p[6]) << 16 | uint32_t(p[7]) << 24;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for (; len > 0; len--, p++) crc = t[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* the scanlines are stored in deflate blocks without compression, so the encoder
+ * costs little more than copying the image
+ */
+inline bool GLExporter::_png(std::ostream& out, const Frame& image) const {
+    auto be32 = [](char* p, uint32_t v) { p[0] = char(v >> 24); p[1] = char(v >> 16); p[2] = char(v >> 8); p[3] = char(v); };
+    auto chunk = [&](const char* type, const std::vector<char>& data) {
+        char head[8], tail[4];
+        be32(head, uint32_t(data.size()));
+        memcpy(head + 4, type, 4);
+        be32(tail, _crc(_crc(0, head + 4, 4), data.data(), data.size()));
+        out.write(head, 8).write(data.data(), data.size()).write(tail, 4);
+    };
+
+    std::vector<char> header(13, 0);
+    be32(&header[0], uint32_t(image.width));
+    be32(&header[4], uint32_t(image.height));
+    header[8] = 8;      //bits per channel
+    header[9] = 2;      //RGB
+
+    size_t stride = image.width * 3, raw = (stride + 1) * image.height;
+    size_t blocks = std::max<size_t>((raw + GLX_STORED - 1) / GLX_STORED, 1);
+    std::vector<char> idat;
+    idat.reserve(2 + raw + blocks * 5 + 4);
+    idat.push_back(0x78), idat.push_back(0x01);
+    uint32_t a = 1, b = 0;  //adler-32 of the scanlines
+    size_t left = 0, run = 0;   //bytes left in the current block, and summed since the last modulo
+    auto put = [&](const char* data, size_t len) {
+        while (len > 0) {
+            if (!left) {
+                left = std::min<size_t>(raw, GLX_STORED);
+                raw -= left;
+                idat.push_back(char(raw == 0));
+                idat.push_back(char(left)), idat.push_back(char(left >> 8));
+                idat.push_back(char(~left)), idat.push_back(char(~left >> 8));
+            }
+            size_t n = std::min(std::min(len, left), GLX_ADLERRUN - run);
+            idat.insert(idat.end(), data, data + n);
+            for (size_t i = 0; i < n; i++) a += uint8_t(data[i]), b += a;
+            if ((run += n) == GLX_ADLERRUN) a %= 65521, b %= 65521, run = 0;
+            data += n, len -= n, left -= n;
+        }
+    };
+    const char filter = 0;
+    for (size_t y = 0; y < image.height; y++) {
+        put(&filter, 1);
+        put(&image.data[y * stride], stride);
+    }
+    a %= 65521, b %= 65521;
+    idat.resize(idat.size() + 4);
+    be32(&idat[idat.size() - 4], (b << 16) | a);
+
+    out.write("\x89PNG\r\n\x1A\n", 8);
+    chunk("IHDR", header);
+    chunk("IDAT", idat);
+    chunk("IEND", std::vector<char>());
+    return bool(out);
+}
@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "glmap.h"
+
+
+#define GLH_MINLEVEL    3
+#define GLH_BLOCKSIZE   (1 << 16)       //nodes allocated at a time
+#define GLH_DEFMEMORY   (size_t(1) << 30)
+
+
+/* a node of the quadtree, hash-consed so that equal subtrees are shared:
+ * a node of level n covers 2^n x 2^n cells, the leaves are the two level 0 cells,
+ * and result is the memoised center of level n - 1 after 2^min(step, n - 2) generations
+ */
+struct GLHNode {
+    GLHNode* nw, * ne, * sw, * se;
+    GLHNode* result;
+    GLHNode* hnext;     //next node of the same hash bucket, or of the free list
+    uint64_t pop;
+    unsigned level;
+    bool mark;
+};
+
+/* HashLife engine on an unbounded plane:
+ * the window [0, width) x [0, height) given at construction is where init() places
+ * cells, and the plane around it grows as needed, the boundless flag is ignored,
+ * rules with B0 are not supported since the empty space must stay empty
+ */
+class GLHashLife {
+public:
+    GLHashLife(size_t width, size_t height)
+        :_width(width), _height(height), _gen(0), _step(0), _budget(GLH_DEFMEMORY), _nodes(0), _limit(GLH_DEFMEMORY / sizeof(GLHNode)),
+        _dead{}, _alive{}, _root(nullptr), _spare(nullptr), _table(GLH_BLOCKSIZE) { _alive.pop = 1; init(); }
+    GLHashLife(const GLHashLife&) = delete;
+    GLHashLife(GLHashLife&&) = delete;
+
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    uint64_t gen() const { return _gen; }
+    void gen(uint64_t gen) { _gen = gen; }
+    bool valid(size_t x, size_t y) const { return (x < _width && y < _height); }
+    uint64_t population() const { return _root->pop; }
+    size_t threads() const { return 1; }
+    size_t nodes() const { return _nodes; }
+    size_t memory() const { return _budget; }
+    void memory(size_t bytes) { _budget = bytes; _limit = bytes / sizeof(GLHNode); }
+    const GLRule& rule() const { return _rule; }
+    void rule(const GLRule& rule) { _rule = rule; _forget(); }
+
+    bool get(long x, long y) const;
+    void window(long left, long top, size_t width, size_t height, bool cells[]) const;
+
+    void init();
+    void init(float ratio, unsigned seed = std::minstd_rand::default_seed);
+    void init(const bool map[], size_t size);
+    void init(std::vector<char>&& cells);   //the cells of the window row by row, taken over
+    void init(const GLPoint coord[], size_t size);
+    void init(const GLRect rect[], size_t size);
+    void next(bool /*boundless*/ = false) { advance(0); }  //the plane is unbounded, neither mode applies
+    void advance(unsigned power);
+
+private:
+    size_t _width, _height;
+    uint64_t _gen;
+    unsigned _step;     //log2 of the generations memoised in results
+    size_t _budget, _nodes;
+    size_t _limit;      //nodes allocated before collecting, raised when a collection frees too little
+    GLHNode _dead, _alive;
+    GLHNode* _root;
+    GLHNode* _spare;    //free list of nodes
+    std::vector<GLHNode*> _table, _zero;    //hash buckets, and the empty node of each level
+    std::vector<GLHNode*> _stack;           //nodes held by the recursions, kept by the collections
+    std::vector<std::unique_ptr<GLHNode[]>> _blocks;
+    GLRule _rule = GLR_CONWAY;
+
+    long _half() const { return long(1) << (_root->level - 1); }   //the root covers [-half, half)
+    long _left() const { return long(_width / 2); }                //the plane origin in the window
+    long _top() const { return long(_height / 2); }
+
+    static size_t _hash(const GLHNode* nw, const GLHNode* ne, const GLHNode* sw, const GLHNode* se);
+
+    GLHNode* _keep(GLHNode* node) { _stack.push_back(node); return node; }
+    GLHNode* _node(GLHNode* nw, GLHNode* ne, GLHNode* sw, GLHNode* se);
+    GLHNode* _empty(unsigned level);
+    GLHNode* _expand(GLHNode* node);
+    GLHNode* _centre(GLHNode* node) { return _node(node->nw->se, node->ne->sw, node->sw->ne, node->se->nw); }
+    GLHNode* _hcentre(GLHNode* w, GLHNode* e) { return _node(w->ne, e->nw, w->se, e->sw); }
+    GLHNode* _vcentre(GLHNode* n, GLHNode* s) { return _node(n->sw, n->se, s->nw, s->ne); }
+    bool _inner(GLHNode* node) const;
+    GLHNode* _base(GLHNode* node);
+    GLHNode* _result(GLHNode* node);
+    GLHNode* _build(const std::vector<char>& cells, unsigned level, long left, long top);
+    void _load(const std::vector<char>& cells);
+    void _window(const GLHNode* node, long left, long top, long wleft, long wtop, size_t width, size_t height, bool cells[]) const;
+    void _mark(GLHNode* node);
+    void _collect();
+    void _rehash(size_t nbuckets);
+    void _forget();
+};
+
+inline size_t GLHashLife::_hash(const GLHNode* nw, const GLHNode* ne, const GLHNode* sw, const GLHNode* se) {
+    size_t hash = (size_t(nw) >> 4) * 3 + (size_t(ne) >> 4) * 5 + (size_t(sw) >> 4) * 7 + (size_t(se) >> 4) * 11;
+    return (hash ^ (hash >> 17)) * 0x9E3779B1u;
+}
+
+/* the budget is checked before every new node, so a single long advance cannot outgrow it,
+ * the children given are kept by the collection along with the nodes on the stack
+ */
+inline GLHNode* GLHashLife::_node(GLHNode* nw, GLHNode* ne, GLHNode* sw, GLHNode* se) {
+    size_t hash = _hash(nw, ne, sw, se);
+    GLHNode** bucket = &_table[hash % _table.size()];
+    for (GLHNode* node = *bucket; node; node = node->hnext)
+        if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se) return node;
+
+    if (_nodes >= _limit) {
+        size_t depth = _stack.size();
+        _keep(nw), _keep(ne), _keep(sw), _keep(se);
+        _collect();
+        _stack.resize(depth);
+        bucket = &_table[hash % _table.size()];
+    }
+    if (!_spare) {  //a new block
+        _blocks.emplace_back(new GLHNode[GLH_BLOCKSIZE]);
+        GLHNode* block = _blocks.back().get();
+        for (size_t i = 0; i < GLH_BLOCKSIZE; i++) block[i].hnext = (i + 1 < GLH_BLOCKSIZE) ? &block[i + 1] : nullptr;
+        _spare = block;
+    }
+    GLHNode* node = _spare;
+    _spare = node->hnext;
+
+    *node = { nw, ne, sw, se, nullptr, *bucket, nw->pop + ne->pop + sw->pop + se->pop, nw->level + 1, false };
+    *bucket = node;
+    if (++_nodes > _table.size()) _rehash(_table.size() * 2);
+    return node;
+}
+
+inline void GLHashLife::_rehash(size_t nbuckets) {
+    std::vector<GLHNode*> table(nbuckets);
+    for (GLHNode* head : _table) {
+        for (GLHNode* node = head, * next; node; node = next) {
+            next = node->hnext;
+            size_t idx = _hash(node->nw, node->ne, node->sw, node->se) % nbuckets;
+            node->hnext = table[idx];
+            table[idx] = node;
+        }
+    }
+    _table.swap(table);
+}
+
+inline GLHNode* GLHashLife::_empty(unsigned level) {
+    if (_zero.empty()) _zero.push_back(&_dead);
+    while (_zero.size() <= level) {
+        GLHNode* e = _zero.back();
+        _zero.push_back(_node(e, e, e, e));
+    }
+    return _zero[level];
+}
+
+/* the node one level up with the same center */
+inline GLHNode* GLHashLife::_expand(GLHNode* node) {
+    size_t depth = _stack.size();
+    _keep(node);
+    GLHNode* e = _empty(node->level - 1);
+    GLHNode* nw = _keep(_node(e, e, e, node->nw));
+    GLHNode* ne = _keep(_node(e, e, node->ne, e));
+    GLHNode* sw = _keep(_node(e, node->sw, e, e));
+    GLHNode* se = _node(node->se, e, e, e);
+    _stack.resize(depth);
+    return _node(nw, ne, sw, se);
+}
+
+/* all alive cells are in the center half of the node */
+inline bool GLHashLife::_inner(GLHNode* node) const {
+    return node->nw->se->pop + node->ne->sw->pop + node->sw->ne->pop + node->se->nw->pop == node->pop;
+}
+
+/* a level 2 node, i.e. 4x4 cells, computed cell by cell */
+inline GLHNode* GLHashLife::_base(GLHNode* node) {
+    unsigned bits = 0;  //bit (y * 4 + x)
+    const GLHNode* quads[4] = { node->nw, node->ne, node->sw, node->se };
+    for (int q = 0; q < 4; q++) {
+        unsigned x = (q & 1) * 2, y = (q >> 1) * 2;
+        bits |= unsigned(quads[q]->nw->pop) << (y * 4 + x);
+        bits |= unsigned(quads[q]->ne->pop) << (y * 4 + x + 1);
+        bits |= unsigned(quads[q]->sw->pop) << (y * 4 + x + 4);
+        bits |= unsigned(quads[q]->se->pop) << (y * 4 + x + 5);
+    }
+
+    GLHNode* cells[4];
+    for (int i = 0; i < 4; i++) {
+        unsigned x = 1 + (i & 1), y = 1 + (i >> 1), cnt = 0;
+        for (unsigned ny = y - 1; ny <= y + 1; ny++)
+            for (unsigned nx = x - 1; nx <= x + 1; nx++)
+                cnt += (bits >> (ny * 4 + nx)) & 1;
+        bool self = (bits >> (y * 4 + x)) & 1;
+        cnt -= self;
+        cells[i] = (_rule(self, cnt)) ? &_alive : &_dead;
+    }
+    return _node(cells[0], cells[1], cells[2], cells[3]);
+}
+
+/* the classic recursion over nine overlapping subnodes of level n - 1:
+ * their centers are advanced (or just taken when the step is smaller than the level
+ * allows), regrouped into four nodes of level n - 1, and those are advanced again,
+ * every node made on the way is kept on the stack until the result is made
+ */
+inline GLHNode* GLHashLife::_result(GLHNode* node) {
+    if (node->result) return node->result;
+    size_t depth = _stack.size();
+    _keep(node);
+
+    GLHNode* result;
+    if (node->pop == 0) {
+        result = _empty(node->level - 1);
+    } else if (node->level == 2) {
+        result = _base(node);
+    } else {
+        GLHNode* sub[9] = { node->nw, nullptr, node->ne, nullptr, nullptr, nullptr, node->sw, nullptr, node->se };
+        sub[1] = _keep(_hcentre(node->nw, node->ne));
+        sub[3] = _keep(_vcentre(node->nw, node->sw));
+        sub[4] = _keep(_centre(node));
+        sub[5] = _keep(_vcentre(node->ne, node->se));
+        sub[7] = _keep(_hcentre(node->sw, node->se));
+        bool full = _step + 2 >= node->level;
+        for (auto& s : sub) s = _keep((full) ? _result(s) : _centre(s));
+
+        GLHNode* nw = _keep(_result(_node(sub[0], sub[1], sub[3], sub[4])));
+        GLHNode* ne = _keep(_result(_node(sub[1], sub[2], sub[4], sub[5])));
+        GLHNode* sw = _keep(_result(_node(sub[3], sub[4], sub[6], sub[7])));
+        GLHNode* se = _result(_node(sub[4], sub[5], sub[7], sub[8]));
+        result = _node(nw, ne, sw, se);
+    }
+    _stack.resize(depth);
+    return node->result = result;
+}
+
+/* advance 2^power generations:
+ * the root is expanded until the pattern lies in its center quarter, far enough from
+ * the edges for the light speed, then the result is the new root of one level lower
+ */
+inline void GLHashLife::advance(unsigned power) {
+    if (power != _step) {   //the memoised results are for another step
+        _forget();
+        _step = power;
+    }
+
+    while (_root->level < power + 2 || !_inner(_root)) _root = _expand(_root);
+    _root = _result(_expand(_root));
+    while (_root->level > GLH_MINLEVEL && _inner(_root)) _root = _centre(_root);
+    _gen += uint64_t(1) << power;
+}
+
+/* drop all memoised results */
+inline void GLHashLife::_forget() {
+    for (GLHNode* head : _table)
+        for (GLHNode* node = head; node; node = node->hnext) node->result = nullptr;
+}
+
+inline void GLHashLife::_mark(GLHNode* node) {
+    if (node->mark || node->level == 0) return;
+    node->mark = true;
+    _mark(node->nw); _mark(node->ne); _mark(node->sw); _mark(node->se);
+}
+
+/* garbage collection:
+ * keep the nodes reachable from the root, if any, or the stack, and the memoised results that
+ * survive, then collect again at twice the nodes left if that is over the budget,
+ * so a pattern outgrowing the budget is not collected for nothing at every node
+ */
+inline void GLHashLife::_collect() {
+    if (_root) _mark(_root);    //none before the first load
+    for (GLHNode* e : _zero) _mark(e);
+    for (GLHNode* node : _stack) _mark(node);
+    for (GLHNode*& head : _table) {
+        for (GLHNode** link = &head; *link;) {
+            GLHNode* node = *link;
+            if (node->mark) { link = &node->hnext; continue; }
+            *link = node->hnext;
+            node->hnext = _spare;
+            _spare = node;
+            _nodes--;
+        }
+    }
+    for (GLHNode* head : _table) {
+        for (GLHNode* node = head; node; node = node->hnext) {
+            if (node->result && !node->result->mark) node->result = nullptr;
+        }
+    }
+    for (GLHNode* head : _table)
+        for (GLHNode* node = head; node; node = node->hnext) node->mark = false;
+    _limit = std::max(_budget / sizeof(GLHNode), 2 * _nodes);
+}
+
+inline bool GLHashLife::get(long x, long y) const {
+    long half = _half();
+    x -= _left(), y -= _top();
+    if (x < -half || x >= half || y < -half || y >= half) return false;
+    x += half, y += half;
+    const GLHNode* node = _root;
+    for (unsigned level = node->level; level > 0 && node->pop; level--) {
+        long mid = long(1) << (level - 1);
+        bool east = x >= mid, south = y >= mid;
+        node = (south) ? ((east) ? node->se : node->sw) : ((east) ? node->ne : node->nw);
+        x -= east * mid, y -= south * mid;
+    }
+    return node->pop;
+}
+
+inline void GLHashLife::_window(const GLHNode* node, long left, long top, long wleft, long wtop, size_t width, size_t height, bool cells[]) const {
+    long size = long(1) << node->level;
+    if (node->pop == 0 || left >= wleft + long(width) || top >= wtop + long(height) || left + size <= wleft || top + size <= wtop) return;
+    if (node->level == 0) {
+        cells[(top - wtop) * width + (left - wleft)] = true;
+        return;
+    }
+    long mid = size / 2;
+    _window(node->nw, left, top, wleft, wtop, width, height, cells);
+    _window(node->ne, left + mid, top, wleft, wtop, width, height, cells);
+    _window(node->sw, left, top + mid, wleft, wtop, width, height, cells);
+    _window(node->se, left + mid, top + mid, wleft, wtop, width, height, cells);
+}
+
+/* cells of the window [left, left + width) x [top, top + height), row by row */
+inline void GLHashLife::window(long left, long top, size_t width, size_t height, bool cells[]) const {
+    std::fill(cells, cells + width * height, false);
+    _window(_root, -_half(), -_half(), left - _left(), top - _top(), width, height, cells);
+}
+
+inline GLHNode* GLHashLife::_build(const std::vector<char>& cells, unsigned level, long left, long top) {
+    long size = long(1) << level, wleft = -_left(), wtop = -_top();
+    if (left >= wleft + long(_width) || top >= wtop + long(_height) || left + size <= wleft || top + size <= wtop) return _empty(level);
+    if (level == 0) return (cells[(top - wtop) * _width + (left - wleft)]) ? &_alive : &_dead;
+    long mid = size / 2;
+    size_t depth = _stack.size();
+    GLHNode* nw = _keep(_build(cells, level - 1, left, top));
+    GLHNode* ne = _keep(_build(cells, level - 1, left + mid, top));
+    GLHNode* sw = _keep(_build(cells, level - 1, left, top + mid));
+    GLHNode* se = _build(cells, level - 1, left + mid, top + mid);
+    _stack.resize(depth);
+    return _node(nw, ne, sw, se);
+}
+
+/* replace the whole plane with the window cells */
+inline void GLHashLife::_load(const std::vector<char>& cells) {
+    unsigned level = GLH_MINLEVEL;
+    long extent = std::max({ _left(), _top(), long(_width) - _left(), long(_height) - _top() });
+    while ((long(1) << (level - 1)) < extent) level++;
+
+    _gen = 0;
+    _root = _empty(level);  //the root is unreachable during the collection
+    _collect();
+    _root = _build(cells, level, -(long(1) << (level - 1)), -(long(1) << (level - 1)));
+}
+
+inline void GLHashLife::init() {
+    _load(std::vector<char>(_width * _height));
+}
+
+inline void GLHashLife::init(float ratio, unsigned seed /*std::minstd_rand::default_seed*/) {
+    GLSoup soup(ratio, seed);   //the same soup as GLMap
+    std::vector<char> cells(_width * _height);
+    for (size_t y = 0; y < _height; y++) soup.row(y, (bool*)cells.data() + y * _width, _width);
+    _load(cells);
+}
+
+inline void GLHashLife::init(const bool map[], size_t size) {
+    std::vector<char> cells(_width * _height);
+    std::copy(map, map + std::min(size, cells.size()), cells.begin());
+    _load(cells);
+}
+
+inline void GLHashLife::init(std::vector<char>&& cells) {
+    std::vector<char> window(std::move(cells));     //released once the quadtree is built
+    window.resize(_width * _height);
+    _load(window);
+}
+
+inline void GLHashLife::init(const GLPoint coord[], size_t size) {
+    std::vector<char> cells(_width * _height);
+    for (size_t i = 0; i < size; i++) {
+        auto& pt = coord[i];
+        if (valid(pt.x, pt.y)) cells[pt.y * _width + pt.x] = true;
+    }
+    _load(cells);
+}
+
+inline void GLHashLife::init(const GLRect rect[], size_t size) {
+    std::vector<char> cells(_width * _height);
+    for (size_t i = 0; i < size; i++) {
+        long left = std::max(rect[i].left, 0L), right = std::min(rect[i].right, (long)_width);
+        long top = std::max(rect[i].top, 0L), bottom = std::min(rect[i].bottom, (long)_height);
+        for (long row = top; left < right && row < bottom; row++)
+            std::fill(cells.begin() + row * _width + left, cells.begin() + row * _width + right, true);
+    }
+    _load(cells);
+}
@@ -0,0 +1,998 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <array>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+
+#include "glmap.h"
+#include "glbitmap.h"
+#include "glhashlife.h"
+#include "glsparse.h"
+#include "glworker.h"
+#include "glhistory.h"
+#include "glpattern.h"
+#include "glsnapshot.h"
+#include "glensemble.h"
+#include "glexport.h"
+#include "glcensus.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include "gldomain.h"
+#endif
+
+
+#define RETVAL_EXIT     0
+#define RETVAL_CMDFAIL  1
+#define RETVAL_BADARGS  2
+#define RETVAL_ERROPEN  3
+#define RETVAL_BADDATA  4
+
+constexpr size_t DEF_GENS = 1000;
+
+constexpr int ENGINE_BYTE = 0;  //GLMap, one bool per cell
+constexpr int ENGINE_BIT = 1;   //GLBitMap, 64 cells per word
+constexpr int ENGINE_HASH = 2;  //GLHashLife, hash-consed quadtree
+constexpr int ENGINE_SPARSE = 3;    //GLSparseMap, occupied tiles only
+
+constexpr auto USAGE = "\
+glheadless [-b] [-c <mode>] [-d <file>] [-e <engine>] [-f <n> <file>] [-g <n>] [-i <MiB>] [-j <n>] [-k <kernel>] [-l <layout>] [-m <MiB>] [-n <width> <height> <seeds> <ratios> <file>] [-o <n> <file>] [-p <k>] [-s <seed>] [-t] [-u <rule>] [-v <dir>] [-w] [-x <cols> <rows>] [-z <width> <height> <seeds> <ratios> <file>] (<file> | -r <width> <height> <scale> <ratio>)\n\n\
+Positional arguments:\n\
+  file                  init file, RLE or plaintext pattern, or snapshot, as for the Win32 app\n\n\
+Optional arguments:\n\
+  -r, --random <width> <height> <scale> <ratio>\n\
+                        random initialization instead of an init file, the scale\n\
+                        is the pixels per cell of the frames written with -f\n\
+  -b, --boundless       wrap around the map edges (Limited Infinity)\n\
+  -c, --cycles <mode>   detect cycles of the byte engine as <find|stop|skip>,\n\
+                        <find> report the period and the generation it began,\n\
+                        <stop> stop running once a cycle is found,\n\
+                        <skip> jump over whole periods once a cycle is found\n\
+  -d, --stats <file>    write the population, births, deaths and bounding box of the\n\
+                        byte engine to <file> as CSV, for every generation, or for\n\
+                        every frame read with -w\n\
+  -e, --engine <engine> set the simulation engine as <byte|bit|hash|sparse>,\n\
+                        <byte> one bool per cell (default),\n\
+                        <bit> bit-packed cells with a bit-parallel kernel,\n\
+                        <hash> HashLife on an unbounded plane, -b is ignored,\n\
+                        <sparse> occupied tiles on an unbounded plane, -b is ignored\n\
+  -f, --frames <n> <file>\n\
+                        write every <n>-th generation of the byte engine as drawn by\n\
+                        the Win32 app, at the scale of the init file or of -r, to\n\
+                        PNG files if <file> ends with .png, or else to PPM files,\n\
+                        a '#' in <file> is replaced by the generation, or <file> is\n\
+                        - to write raw RGB24 frames to stdout, the report goes to stderr\n\
+  -g, --gens <n>        number of generations to run (default 1000),\n\
+                        or of steps for the hash engine\n\
+  -i, --history <MiB>   record every generation of the byte engine in a rewind history\n\
+                        of at most <MiB>, and report the time to record and to seek\n\
+  -j, --jobs <n>        number of threads stepping the map (default all cores)\n\
+  -k, --kernel <kernel> set the row kernel of the byte engine as <auto|scalar|sse2|avx2>,\n\
+                        <auto> the best one supported by the CPU (default)\n\
+  -l, --layout <layout> set the memory layout of the byte engine as <flat|padded>,\n\
+                        <flat> contiguous rows with per-cell edge handling (default),\n\
+                        <padded> rows surrounded by a halo refreshed per generation\n\
+  -m, --memory <MiB>    memory budget of the hash engine before collecting garbage\n\
+                        (default 1024)\n\
+  -n, --ensemble <width> <height> <seeds> <ratios> <file>\n\
+                        instead of an init file, run a random map of the byte engine\n\
+                        for every seed of <first>[-<last>] and every ratio of a comma\n\
+                        separated list, one map per thread, cycles skipped unless -c\n\
+                        is given, and write a summary of every run to <file> as CSV\n\
+  -o, --snapshot <n> <file>\n\
+                        write a snapshot of the byte or bit engine to <file> every\n\
+                        <n> generations and after the last one\n\
+  -p, --power <k>       advance 2^k generations per step of the hash engine (default 0)\n\
+  -s, --seed <n>        seed for random initialization (default random)\n\
+  -t, --tiles           skip the tiles of the byte engine that did not change\n\
+  -u, --rule <rule>     set the rule in B/S notation, e.g. B36/S23 (default the rule\n\
+                        of the init file, or B3/S23), B0 rules need the byte or bit engine\n\
+  -v, --volume <dir>    keep both buffers of the byte engine in temporary files of <dir>\n\
+                        mapped into memory, for maps larger than memory\n\
+  -w, --worker          step the byte engine on a worker thread, while the main thread\n\
+                        reads the published frames without blocking\n\
+  -x, --domains <cols> <rows>\n\
+                        split the map of the byte engine into <cols> x <rows> domains,\n\
+                        each stepped by a worker process with -j threads (default the\n\
+                        cores shared out), exchanging their edges through shared memory,\n\
+                        snapshots of -o are assembled by the calling process (POSIX only)\n\
+  -z, --census <width> <height> <seeds> <ratios> <file>\n\
+                        instead of an init file, run a random soup of the bit engine\n\
+                        for every seed and ratio as with -n, in arenas grown around\n\
+                        the soup, for at most -g generations (default 20000), and\n\
+                        write the objects left by all soups to <file> as CSV, by\n\
+                        apgcode, most common first\n\
+";
+
+
+class ParseError : public std::logic_error {
+public:
+    using std::logic_error::logic_error;
+};
+
+struct Args {
+    bool boundless;
+    int engine;
+    int nthreads;
+    int kernel;
+    int layout;
+    bool tiles;
+    bool worker;
+    int cycles;
+    std::string rule;
+    size_t interval;
+    std::string snapshot;
+    std::string stats;
+    size_t history;
+    size_t memory;
+    unsigned power;
+    bool random;
+    size_t gens;
+    unsigned seed;
+    long width;
+    long height;
+    float ratio;
+    std::string fname;
+    bool ensemble;
+    unsigned first, last;
+    std::vector<float> ratios;
+    std::string summary;
+    size_t every;
+    std::string frames;
+    int scale;
+    bool census;
+    std::string catalogue;
+    size_t cols, rows;
+    std::string volume;
+} args_{};
+
+size_t frames_ = 0;     //frames read from the worker
+size_t snapshots_ = 0;  //snapshots written
+double loading_ = 0;    //seconds spent initialising the map
+std::ofstream stats_;   //statistics of the byte engine, as CSV
+size_t records_ = 0;    //lines of statistics written
+size_t recorded_ = 0;   //generation of the last line
+std::unique_ptr<GLHistory> history_;    //of the byte engine
+double recording_ = 0;  //seconds spent recording the history
+std::unique_ptr<std::ostream> stdout_;  //of the raw frames, std::cout writes to stderr instead
+std::unique_ptr<GLExporter> exporter_;  //of the byte engine
+size_t exported_ = 0;   //generation of the last frame
+
+
+inline void assert(const bool condition, const std::string& message) {
+    if (!condition) throw ParseError(message);
+}
+
+template<class T>
+inline T argton(const char* str, const std::string& name) {
+    std::istringstream data(str);
+    T val;
+    assert(data >> val && data.peek() == EOF, "invalid value for " + name);
+    return val;
+}
+
+/* <width> <height> <first>[-<last>] <ratio>[,<ratio>...] from argv[idx + 1] */
+void parseSoups(char* argv[], int idx) {
+    assert(args_.ratios.empty(), "an ensemble and a census cannot be combined");
+    args_.width = argton<long>(argv[idx + 1], "width");
+    args_.height = argton<long>(argv[idx + 2], "height");
+    assert(args_.width > 0 && args_.height > 0, "invalid map size");
+    std::string seeds = argv[idx + 3];
+    size_t dash = seeds.find('-', 1);
+    args_.first = argton<unsigned>(seeds.substr(0, dash).c_str(), "seeds");
+    args_.last = (dash == seeds.npos) ? args_.first : argton<unsigned>(seeds.substr(dash + 1).c_str(), "seeds");
+    assert(args_.first <= args_.last, "invalid value for seeds");
+    std::istringstream ratios(argv[idx + 4]);
+    for (std::string ratio; std::getline(ratios, ratio, ',');) args_.ratios.push_back(argton<float>(ratio.c_str(), "ratios"));
+    assert(!args_.ratios.empty(), "invalid value for ratios");
+}
+
+/* optional args:
+ * [-b] [-c <mode>] [-d <file>] [-e <engine>] [-f <n> <file>] [-g <n>] [-i <MiB>] [-j <n>] [-k <kernel>] [-l <layout>] [-m <MiB>] [-n <width> <height> <seeds> <ratios> <file>] [-o <n> <file>] [-p <k>] [-s <seed>] [-t] [-u <rule>] [-v <dir>] [-w] [-x <cols> <rows>] [-z <width> <height> <seeds> <ratios> <file>] [-r <width> <height> <scale> <ratio>]
+ */
+int matchOptionalArgs(int argc, char* argv[], int idx, std::array<bool, 22>& parsed) {
+    if (!std::strcmp(argv[idx], "-b") || !std::strcmp(argv[idx], "--boundless")) {   //wrap around edges
+        assert(!parsed[0], "duplicate option: " + std::string(argv[idx]));
+
+        args_.boundless = true;
+
+        parsed[0] = true;
+        return 1;
+    } else if (!std::strcmp(argv[idx], "-g") || !std::strcmp(argv[idx], "--gens")) {   //number of generations
+        assert(!parsed[1], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for gens");
+
+        args_.gens = argton<size_t>(argv[idx + 1], "gens");
+
+        parsed[1] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-s") || !std::strcmp(argv[idx], "--seed")) {   //random seed
+        assert(!parsed[2], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for seed");
+
+        args_.seed = argton<unsigned>(argv[idx + 1], "seed");
+
+        parsed[2] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-r") || !std::strcmp(argv[idx], "--random")) { //random initialization
+        assert(!parsed[3], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 4 < argc, "insufficient arguments for random");
+
+        args_.width = argton<long>(argv[idx + 1], "width");
+        args_.height = argton<long>(argv[idx + 2], "height");
+        args_.scale = argton<int>(argv[idx + 3], "scale");
+        args_.ratio = argton<float>(argv[idx + 4], "ratio");
+        assert(args_.width > 0 && args_.height > 0, "invalid map size");
+        args_.random = true;
+
+        parsed[3] = true;
+        return 5;
+    } else if (!std::strcmp(argv[idx], "-e") || !std::strcmp(argv[idx], "--engine")) { //simulation engine
+        assert(!parsed[4], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified engine");
+
+        if (!std::strcmp(argv[idx + 1], "byte")) args_.engine = ENGINE_BYTE;
+        else if (!std::strcmp(argv[idx + 1], "bit")) args_.engine = ENGINE_BIT;
+        else if (!std::strcmp(argv[idx + 1], "hash")) args_.engine = ENGINE_HASH;
+        else if (!std::strcmp(argv[idx + 1], "sparse")) args_.engine = ENGINE_SPARSE;
+        else throw ParseError("unknow engine");
+
+        parsed[4] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-j") || !std::strcmp(argv[idx], "--jobs")) {   //specify working threads
+        assert(!parsed[5], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for jobs");
+
+        args_.nthreads = argton<int>(argv[idx + 1], "jobs");
+        assert(args_.nthreads > 0, "invalid value for jobs");
+
+        parsed[5] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-k") || !std::strcmp(argv[idx], "--kernel")) { //row kernel
+        assert(!parsed[6], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified kernel");
+
+        if (!std::strcmp(argv[idx + 1], "auto")) args_.kernel = GLK_AVX2;
+        else if (!std::strcmp(argv[idx + 1], "scalar")) args_.kernel = GLK_SCALAR;
+        else if (!std::strcmp(argv[idx + 1], "sse2")) args_.kernel = GLK_SSE2;
+        else if (!std::strcmp(argv[idx + 1], "avx2")) args_.kernel = GLK_AVX2;
+        else throw ParseError("unknow kernel");
+
+        parsed[6] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-l") || !std::strcmp(argv[idx], "--layout")) { //memory layout
+        assert(!parsed[7], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified layout");
+
+        if (!std::strcmp(argv[idx + 1], "flat")) args_.layout = GLM_FLAT;
+        else if (!std::strcmp(argv[idx + 1], "padded")) args_.layout = GLM_PADDED;
+        else throw ParseError("unknow layout");
+
+        parsed[7] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-t") || !std::strcmp(argv[idx], "--tiles")) {  //active tile tracking
+        assert(!parsed[8], "duplicate option: " + std::string(argv[idx]));
+
+        args_.tiles = true;
+
+        parsed[8] = true;
+        return 1;
+    } else if (!std::strcmp(argv[idx], "-m") || !std::strcmp(argv[idx], "--memory")) { //hash engine memory
+        assert(!parsed[9], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for memory");
+
+        args_.memory = argton<size_t>(argv[idx + 1], "memory");
+        assert(args_.memory > 0, "invalid value for memory");
+
+        parsed[9] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-p") || !std::strcmp(argv[idx], "--power")) {  //hash engine step
+        assert(!parsed[10], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for power");
+
+        args_.power = argton<unsigned>(argv[idx + 1], "power");
+        assert(args_.power < 64, "invalid value for power");
+
+        parsed[10] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-w") || !std::strcmp(argv[idx], "--worker")) { //worker thread
+        assert(!parsed[11], "duplicate option: " + std::string(argv[idx]));
+
+        args_.worker = true;
+
+        parsed[11] = true;
+        return 1;
+    } else if (!std::strcmp(argv[idx], "-c") || !std::strcmp(argv[idx], "--cycles")) { //cycle detection
+        assert(!parsed[12], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for cycles");
+
+        if (!std::strcmp(argv[idx + 1], "find")) args_.cycles = GLM_CYCLEFIND;
+        else if (!std::strcmp(argv[idx + 1], "stop")) args_.cycles = GLM_CYCLESTOP;
+        else if (!std::strcmp(argv[idx + 1], "skip")) args_.cycles = GLM_CYCLESKIP;
+        else throw ParseError("unknow cycle mode");
+
+        parsed[12] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-u") || !std::strcmp(argv[idx], "--rule")) {   //rule
+        assert(!parsed[13], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for rule");
+
+        GLRule rule;
+        assert(parseRule(argv[idx + 1], rule), "invalid value for rule");
+        args_.rule = argv[idx + 1];
+
+        parsed[13] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-o") || !std::strcmp(argv[idx], "--snapshot")) {   //snapshots
+        assert(!parsed[14], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 2 < argc, "insufficient arguments for snapshot");
+
+        args_.interval = argton<size_t>(argv[idx + 1], "snapshot interval");
+        assert(args_.interval > 0, "invalid value for snapshot interval");
+        args_.snapshot = argv[idx + 2];
+
+        parsed[14] = true;
+        return 3;
+    } else if (!std::strcmp(argv[idx], "-d") || !std::strcmp(argv[idx], "--stats")) {  //statistics
+        assert(!parsed[15], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified file for stats");
+
+        args_.stats = argv[idx + 1];
+
+        parsed[15] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-n") || !std::strcmp(argv[idx], "--ensemble")) {   //ensemble of random maps
+        assert(!parsed[16], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 5 < argc, "insufficient arguments for ensemble");
+
+        parseSoups(argv, idx);
+        args_.summary = argv[idx + 5];
+        args_.ensemble = true;
+
+        parsed[16] = true;
+        return 6;
+    } else if (!std::strcmp(argv[idx], "-i") || !std::strcmp(argv[idx], "--history")) {    //rewind history
+        assert(!parsed[17], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified value for history");
+
+        args_.history = argton<size_t>(argv[idx + 1], "history");
+        assert(args_.history > 0, "invalid value for history");
+
+        parsed[17] = true;
+        return 2;
+    } else if (!std::strcmp(argv[idx], "-f") || !std::strcmp(argv[idx], "--frames")) { //frames
+        assert(!parsed[18], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 2 < argc, "insufficient arguments for frames");
+
+        args_.every = argton<size_t>(argv[idx + 1], "frames interval");
+        assert(args_.every > 0, "invalid value for frames interval");
+        args_.frames = argv[idx + 2];
+
+        parsed[18] = true;
+        return 3;
+    } else if (!std::strcmp(argv[idx], "-z") || !std::strcmp(argv[idx], "--census")) {  //census of random soups
+        assert(!parsed[19], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 5 < argc, "insufficient arguments for census");
+
+        parseSoups(argv, idx);
+        assert(size_t(args_.width) <= GLCS_MAXSIDE - 2 * GLCS_MARGIN && size_t(args_.height) <= GLCS_MAXSIDE - 2 * GLCS_MARGIN, "invalid soup size");
+        args_.catalogue = argv[idx + 5];
+        args_.census = true;
+
+        parsed[19] = true;
+        return 6;
+    } else if (!std::strcmp(argv[idx], "-x") || !std::strcmp(argv[idx], "--domains")) { //domains of worker processes
+        assert(!parsed[20], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 2 < argc, "insufficient arguments for domains");
+
+        args_.cols = argton<size_t>(argv[idx + 1], "cols");
+        args_.rows = argton<size_t>(argv[idx + 2], "rows");
+        assert(args_.cols > 0 && args_.rows > 0, "invalid value for domains");
+
+        parsed[20] = true;
+        return 3;
+    } else if (!std::strcmp(argv[idx], "-v") || !std::strcmp(argv[idx], "--volume")) { //mapped buffers
+        assert(!parsed[21], "duplicate option: " + std::string(argv[idx]));
+        assert(idx + 1 < argc, "unspecified directory for volume");
+
+        args_.volume = argv[idx + 1];
+
+        parsed[21] = true;
+        return 2;
+    }
+    return 0;
+}
+
+/* positional args:
+ * <file>
+ */
+int matchPositionalArgs(int, char* argv[], int idx, int& pos) {
+    if (argv[idx][0] == '-') return 0;  //unknown option
+    switch (pos) {
+    case 0: {   //init file name
+        args_.fname = argv[idx];
+
+        pos++;
+        return 1;
+    }
+    }
+    return 0;
+}
+
+bool parseHelp(int argc, char* argv[]) {
+    for (int idx = 1; idx < argc; idx++)
+        if (!std::strcmp(argv[idx], "-h") || !std::strcmp(argv[idx], "--help"))
+            return true;
+    return argc == 1;
+}
+
+bool parseArgs(int argc, char* argv[]) {
+    //default value of args
+    args_.gens = DEF_GENS;
+    args_.seed = std::random_device{}();
+    args_.nthreads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    args_.kernel = GLK_AVX2;
+    args_.memory = GLH_DEFMEMORY >> 20;
+
+    try {
+        int curr_pos = 0;   //init state for positional args
+        std::array<bool, 22> parsed_options = {};    //init state for options
+
+        for (int ret, idx = 1; idx < argc; idx += ret) {    //parse options first
+            if ((ret = matchOptionalArgs(argc, argv, idx, parsed_options))) continue;
+            if ((ret = matchPositionalArgs(argc, argv, idx, curr_pos))) continue;
+            throw ParseError("unknow argument: " + std::string(argv[idx]));
+        }
+
+        assert(args_.random + (curr_pos > 0) + args_.ensemble + args_.census == 1, "either an init file, random initialization, an ensemble or a census is required");
+        assert(!args_.ensemble || (args_.engine == ENGINE_BYTE && !args_.worker && args_.snapshot.empty() && args_.stats.empty() && !args_.history), "ensembles need the byte engine, without -d, -i, -o or -w");
+        if (args_.ensemble && !parsed_options[12]) args_.cycles = GLM_CYCLESKIP;
+        assert(args_.snapshot.empty() || args_.engine == ENGINE_BYTE || args_.engine == ENGINE_BIT, "snapshots need the byte or bit engine");
+        assert(args_.stats.empty() || args_.engine == ENGINE_BYTE, "statistics need the byte engine");
+        assert(!args_.history || args_.engine == ENGINE_BYTE, "history needs the byte engine");
+        assert(args_.frames.empty() || (args_.engine == ENGINE_BYTE && !args_.worker && !args_.ensemble), "frames need the byte engine, without -n or -w");
+        if (args_.census && !parsed_options[4]) args_.engine = ENGINE_BIT;
+        assert(!args_.census || (args_.engine == ENGINE_BIT && !args_.worker && args_.snapshot.empty() && args_.stats.empty() && !args_.history && args_.frames.empty() && !args_.boundless && !args_.tiles && !args_.cycles), "a census needs the bit engine, without -b, -c, -d, -f, -i, -o, -t or -w");
+        if (args_.census && !parsed_options[1]) args_.gens = GLCS_DEFGENS;
+        assert(!args_.cols || (args_.engine == ENGINE_BYTE && !args_.worker && !args_.ensemble && !args_.census && args_.stats.empty() && !args_.history && args_.frames.empty() && !args_.tiles && !args_.cycles), "domains need the byte engine, without -c, -d, -f, -i, -n, -t, -w or -z");
+        if (args_.cols) args_.layout = GLM_PADDED;  //the halos are exchanged
+        assert(args_.volume.empty() || (args_.engine == ENGINE_BYTE && !args_.worker && !args_.ensemble && !args_.census && !args_.cols && args_.frames.empty()), "mapped buffers need the byte engine, without -f, -n, -w, -x or -z");
+        if (args_.cols && !parsed_options[5]) args_.nthreads = std::max<int>(args_.nthreads / int(args_.cols * args_.rows), 1);
+    } catch (ParseError& pe) {
+        std::cerr << pe.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+std::string setup(GLMap& map) {
+    static const char* kernels[] = { "scalar", "sse2", "avx2" };
+    static const char* layouts[] = { "flat", "padded" };
+    static const char* cycles[] = { "", "/find", "/stop", "/skip" };
+    map.threads((args_.ensemble || args_.census) ? 1 : args_.nthreads);    //the maps of an ensemble or a census share the threads
+    map.kernel(args_.kernel);
+    map.layout(args_.layout);
+    map.tiles(args_.tiles);
+    map.cycles(args_.cycles);
+    return std::string("byte/") + layouts[map.layout()] + '/' + kernels[map.kernel()] + (map.tiles() ? "/tiles" : "") + cycles[map.cycles()] + (map.mapped() ? "/mapped" : "") + (args_.worker ? "/worker" : "");
+}
+
+std::string setup(GLBitMap& map) {
+    map.threads(args_.nthreads);
+    return "bit";
+}
+
+std::string setup(GLHashLife& map) {
+    map.memory(args_.memory << 20);
+    return "hash/2^" + std::to_string(args_.power);
+}
+
+std::string setup(GLSparseMap&) {
+    return "sparse";
+}
+
+/* once per generation, the generations not seen are not recorded */
+void record(const GLStats& stats) {
+    if (records_ && stats.gen <= recorded_) return;
+    stats_ << stats.gen << ',' << stats.population << ',' << stats.births << ',' << stats.deaths << ',';
+    stats_ << stats.bbox.left << ',' << stats.bbox.top << ',' << stats.bbox.right << ',' << stats.bbox.bottom << '\n';
+    recorded_ = stats.gen;
+    records_++;
+}
+
+void record(const GLMap& map) {
+    auto start = std::chrono::steady_clock::now();
+    history_->record(map);
+    recording_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* the first generation at or after the next multiple of the interval, so that
+ * the periods skipped by a cycle do not stop the frames
+ */
+void exportFrame(const GLMap& map) {
+    if (exporter_->frames() && map.gen() < (exported_ / args_.every + 1) * args_.every) return;
+    exporter_->push(map);
+    exported_ = map.gen();
+}
+
+/* the initial map is counted, recorded and exported */
+template<class Map>
+void prepare(Map&) {}
+
+void prepare(GLMap& map) {
+    if (stats_.is_open()) map.tally(true), record(map.stats());
+    if (history_) record(map);
+    if (exporter_) exportFrame(map);
+}
+
+template<class Map>
+void step(Map& map, size_t steps) { for (size_t i = 0; i < steps; i++) map.next(args_.boundless); }
+
+/* with statistics, history or frames, the map is stepped one generation at a time */
+void step(GLMap& map, size_t steps) {
+    if (!args_.worker && (map.tally() || history_ || exporter_)) {
+        for (size_t i = 0; i < steps; i++) {
+            size_t gen = map.gen();
+            map.next(args_.boundless);
+            if (map.gen() == gen) break;    //stopped by a cycle
+            if (map.tally()) record(map.stats());
+            if (history_) record(map);
+            if (exporter_) exportFrame(map);
+        }
+        return;
+    }
+    if (!args_.worker) return map.next(args_.boundless, steps);
+
+    size_t target = map.gen() + steps;
+    GLWorker worker(map, history_.get());
+    worker.boundless(args_.boundless);
+    worker.step(steps);
+    while (worker.frame().gen < target) {   //poll like a UI would, never waiting for the worker
+        if (args_.cycles == GLM_CYCLESTOP && worker.frame().period) break;
+        if (!worker.update()) std::this_thread::yield();
+        else if (frames_++, map.tally()) record(worker.frame().stats);
+    }
+}
+
+void step(GLHashLife& map, size_t steps) { for (size_t i = 0; i < steps; i++) map.advance(args_.power); }
+
+template<class Map>
+const char* mode(const Map&) { return (args_.boundless) ? "boundless" : "bounded"; }
+
+const char* mode(const GLHashLife&) { return "unbounded"; }
+
+const char* mode(const GLSparseMap&) { return "unbounded"; }
+
+template<class Map>
+void bounds(const Map& map) {
+    GLRect rect;
+    if (map.bounds(rect)) std::cout << "  bbox = [" << rect.left << ", " << rect.right << ") x [" << rect.top << ", " << rect.bottom << ")\n";
+    else std::cout << "  bbox = empty\n";
+}
+
+void bounds(const GLHashLife&) {}
+
+template<class Map>
+void cycle(const Map&) {}
+
+void cycle(const GLMap& map) {
+    if (!map.cycles()) return;
+    if (map.period()) std::cout << "  cycle = period " << map.period() << " from gen " << map.entry() << '\n';
+    else std::cout << "  cycle = none with a period up to " << GLM_HISTORY << '\n';
+}
+
+/* written aside then renamed, so that an interrupted run keeps the previous snapshot */
+template<class Map>
+bool snapshot(const Map& map) {
+    std::string temp = args_.snapshot + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary);
+        if (!file.is_open() || !saveSnapshot(file, map, args_.boundless)) return false;
+    }
+    std::remove(args_.snapshot.c_str());
+    if (std::rename(temp.c_str(), args_.snapshot.c_str())) return false;
+    snapshots_++;
+    return true;
+}
+
+bool snapshot(const GLHashLife&) { return false; }
+
+bool snapshot(const GLSparseMap&) { return false; }
+
+/* the mean time to fetch a retained generation, over up to 100 of them evenly spaced */
+void history() {
+    using clock = std::chrono::steady_clock;
+
+    std::vector<uint64_t> words;
+    size_t first = history_->first(), last = history_->last(), stride = std::max<size_t>((last - first) / 100, 1), seeks = 0;
+    auto start = clock::now();
+    for (size_t gen = first; gen <= last; gen += stride) seeks += history_->fetch(gen, words);
+    std::chrono::duration<double> seeking = clock::now() - start;
+
+    std::cout << std::fixed << "  history = gens " << first << " - " << last << " in " << history_->memory() / double(1 << 20) << " MiB  ";
+    if (!args_.worker) std::cout << "record = " << recording_ << " s  ";
+    std::cout << "seek = " << seeking.count() / std::max<size_t>(seeks, 1) * 1000 << " ms\n";
+}
+
+/* the stages run alongside the simulation, so the slowest one bounds the frame rate */
+void frames(double flushing) {
+    double slowest = std::max(exporter_->rendering(), exporter_->writing());
+    std::cout << std::fixed << "  export = " << exporter_->frames() << " frames of " << exporter_->width() << 'x' << exporter_->height() << "  ";
+    std::cout << "render = " << exporter_->rendering() << " s  write = " << exporter_->writing() << " s  flush = " << flushing << " s  ";
+    std::cout << "speed = " << ((slowest > 0) ? exporter_->frames() / slowest : 0) << " frame/s\n";
+    if (exporter_->failed()) std::cerr << "unable to write frames: " << args_.frames << std::endl;
+}
+
+template<class Map>
+void simulate(Map& map, const std::string& engine) {
+    using clock = std::chrono::steady_clock;
+
+    size_t first = map.gen(), chunk = (args_.snapshot.empty()) ? args_.gens : args_.interval;
+    std::chrono::duration<double> saving{};
+    prepare(map);
+    auto start = clock::now();
+    for (size_t done = 0; done < args_.gens; done += chunk) {
+        step(map, std::min(chunk, args_.gens - done));
+        if (args_.snapshot.empty()) continue;
+        auto now = clock::now();
+        if (!snapshot(map)) std::cerr << "unable to write snapshot: " << args_.snapshot << std::endl;
+        saving += clock::now() - now;
+    }
+    auto finishing = clock::now();
+    if (exporter_) exporter_->finish();     //the frames still in flight are not part of the elapsed time
+    std::chrono::duration<double> elapsed = finishing - start - saving - std::chrono::duration<double>(recording_);
+
+    double gps = (elapsed.count() > 0) ? (map.gen() - first) / elapsed.count() : 0;
+    std::cout << "  engine = " << engine << "  ";
+    std::cout << "map = " << map.width() << 'x' << map.height() << "  ";
+    std::cout << "mode = " << mode(map) << "  ";
+    std::cout << "rule = " << ruleString(map.rule()) << "  ";
+    std::cout << "gens = " << map.gen() << "  ";
+    std::cout << "threads = " << map.threads() << '\n';
+    std::cout << std::string(80, '-') << '\n';
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  load = " << loading_ << " s  ";
+    std::cout << "elapsed = " << elapsed.count() << " s  ";
+    std::cout << "speed = " << gps << " gen/s  ";
+    std::cout << std::scientific << gps * map.width() * map.height() << " cell/s\n";
+    std::cout << "  population = " << map.population() << '\n';
+    if (frames_ > 0) std::cout << "  frames = " << frames_ << '\n';
+    if (snapshots_ > 0) std::cout << std::fixed << "  snapshots = " << snapshots_ << " in " << saving.count() << " s\n";
+    if (records_ > 0) std::cout << "  stats = " << records_ << " generations\n";
+    if (history_) history();
+    if (exporter_) frames(std::chrono::duration<double>(clock::now() - finishing).count());
+    bounds(map);
+    cycle(map);
+    std::cout << std::flush;
+}
+
+/* drawn as in the window at the scale given, or by default the one of the window */
+template<class Map>
+void exporter(const Map&, int) {}
+
+void exporter(const GLMap&, int scale) {
+    if (args_.frames.empty()) return;
+    scale = std::min(std::max((scale > 0) ? scale : GLX_DEFSCALE, GLX_MINSCALE), GLX_MAXSCALE);
+    GLPalette palette = { GLX_COLBLANK, GLX_COLCELL, (args_.boundless) ? GLX_COLBORDER : GLX_COLBARRIER, GLX_COLBOUNDS };
+    if (args_.frames != "-") {
+        size_t dot = args_.frames.rfind('.');
+        bool png = dot != args_.frames.npos && args_.frames.substr(dot) == ".png";
+        exporter_.reset(new GLExporter(args_.frames, (png) ? GLX_PNG : GLX_PPM, scale, palette));
+        return;
+    }
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    stdout_.reset(new std::ostream(std::cout.rdbuf(std::cerr.rdbuf())));
+    exporter_.reset(new GLExporter(args_.frames, GLX_RAW, scale, palette, stdout_.get()));
+}
+
+/* the rule of the command line overrides the one of the init file */
+template<class Map>
+bool applyRule(Map& map, GLRule rule) {
+    if (!args_.rule.empty()) parseRule(args_.rule.c_str(), rule);
+    if ((rule.birth & 1) && (args_.engine == ENGINE_HASH || args_.engine == ENGINE_SPARSE)) {
+        std::cerr << "B0 rules need the byte or bit engine" << std::endl;
+        return false;
+    }
+    map.rule(rule);
+    return true;
+}
+
+/* the byte engine keeps its buffers in files with -v, null if they cannot be mapped */
+template<class Map>
+std::unique_ptr<Map> create(size_t width, size_t height) { return std::unique_ptr<Map>(new Map(width, height)); }
+
+template<>
+std::unique_ptr<GLMap> create<GLMap>(size_t width, size_t height) {
+    try {
+        return std::unique_ptr<GLMap>(new GLMap(width, height, args_.volume));
+    } catch (std::runtime_error& re) {
+        std::cerr << re.what() << std::endl;
+        return nullptr;
+    }
+}
+
+template<class Map>
+int run() {
+    using clock = std::chrono::steady_clock;
+
+    if (!args_.stats.empty()) {
+        stats_.open(args_.stats);
+        if (!stats_.is_open()) {
+            std::cerr << "unable to open file: " << args_.stats << std::endl;
+            return RETVAL_ERROPEN;
+        }
+        stats_ << "gen,population,births,deaths,left,top,right,bottom\n";
+    }
+    if (args_.history) history_.reset(new GLHistory(args_.history << 20));
+
+    if (args_.random) {
+        std::unique_ptr<Map> owner = create<Map>(args_.width, args_.height);
+        if (!owner) return RETVAL_ERROPEN;
+        Map& map = *owner;
+        std::string engine = setup(map);    //the threads of the map also fill the soup
+        auto start = clock::now();
+        map.init(args_.ratio, args_.seed);
+        loading_ = std::chrono::duration<double>(clock::now() - start).count();
+        if (!applyRule(map, GLR_CONWAY)) return RETVAL_BADARGS;
+        exporter(map, args_.scale);
+        simulate(map, engine);
+        return RETVAL_EXIT;
+    }
+
+    GLPattern pattern;
+    if (!pattern.open(args_.fname.c_str())) {
+        std::cerr << "unable to open file: " << args_.fname << std::endl;
+        return RETVAL_ERROPEN;
+    }
+    if (!pattern.parse()) {
+        std::cerr << "bad file contents: " << args_.fname << std::endl;
+        return RETVAL_BADDATA;
+    }
+
+    std::unique_ptr<Map> owner = create<Map>(pattern.width(), pattern.height());
+    if (!owner) return RETVAL_ERROPEN;
+    Map& map = *owner;
+    std::string engine = setup(map);
+    auto start = clock::now();
+    pattern.load(map, args_.seed);
+    loading_ = std::chrono::duration<double>(clock::now() - start).count();
+    pattern.close();
+    args_.boundless |= pattern.boundless();
+    if (!applyRule(map, pattern.rule())) return RETVAL_BADARGS;
+    exporter(map, pattern.scale());
+    simulate(map, engine);
+    return RETVAL_EXIT;
+}
+
+/* the runs follow the ratios, then the seeds, and the speed counts the generations
+ * reached by all runs, including the periods skipped
+ */
+int ensemble() {
+    using clock = std::chrono::steady_clock;
+
+    std::ofstream summary(args_.summary);
+    if (!summary.is_open()) {
+        std::cerr << "unable to open file: " << args_.summary << std::endl;
+        return RETVAL_ERROPEN;
+    }
+
+    std::vector<GLRun> runs;
+    for (float ratio : args_.ratios)
+        for (unsigned seed = args_.first; ; seed++) {
+            runs.push_back({ seed, ratio });
+            if (seed == args_.last) break;
+        }
+
+    GLMap probe(1, 1);
+    std::string engine = setup(probe) + "/ensemble";
+    if (!applyRule(probe, GLR_CONWAY)) return RETVAL_BADARGS;
+    GLEnsemble ensemble(args_.width, args_.height, args_.nthreads);
+    ensemble.setup([](GLMap& map) { setup(map); applyRule(map, GLR_CONWAY); });
+
+    auto start = clock::now();
+    ensemble.run(runs, args_.gens, args_.boundless);
+    std::chrono::duration<double> elapsed = clock::now() - start;
+
+    size_t gens = 0, cycles = 0;
+    summary << "seed,ratio,gens,population,period,entry,seconds\n";
+    for (auto& run : runs) {
+        summary << run.seed << ',' << run.ratio << ',' << run.gen << ',' << run.population << ',';
+        summary << run.period << ',' << run.entry << ',' << run.seconds << '\n';
+        gens += run.gen;
+        cycles += run.period > 0;
+    }
+    if (!summary.flush()) std::cerr << "unable to write summary: " << args_.summary << std::endl;
+
+    double rps = (elapsed.count() > 0) ? runs.size() / elapsed.count() : 0;
+    double gps = (elapsed.count() > 0) ? gens / elapsed.count() : 0;
+    std::cout << "  engine = " << engine << "  ";
+    std::cout << "map = " << args_.width << 'x' << args_.height << "  ";
+    std::cout << "mode = " << mode(probe) << "  ";
+    std::cout << "rule = " << ruleString(probe.rule()) << "  ";
+    std::cout << "gens = " << args_.gens << "  ";
+    std::cout << "threads = " << ensemble.threads() << '\n';
+    std::cout << std::string(80, '-') << '\n';
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  elapsed = " << elapsed.count() << " s  ";
+    std::cout << "speed = " << rps << " run/s  ";
+    std::cout << std::scientific << gps * args_.width * args_.height << " cell/s\n";
+    std::cout << "  runs = " << runs.size() << "  maps = " << ensemble.maps() << "  cycles = " << cycles << '\n';
+    std::cout << std::flush;
+    return RETVAL_EXIT;
+}
+
+/* the soups follow the ratios, then the seeds, as the runs of an ensemble, and
+ * the speed counts the generations stepped by all soups over the soup size
+ */
+int census() {
+    using clock = std::chrono::steady_clock;
+
+    std::ofstream catalogue(args_.catalogue);
+    if (!catalogue.is_open()) {
+        std::cerr << "unable to open file: " << args_.catalogue << std::endl;
+        return RETVAL_ERROPEN;
+    }
+
+    std::vector<std::pair<unsigned, float>> soups;
+    for (float ratio : args_.ratios)
+        for (unsigned seed = args_.first; ; seed++) {
+            soups.push_back({ seed, ratio });
+            if (seed == args_.last) break;
+        }
+
+    GLBitMap probe(1, 1);
+    std::string engine = setup(probe) + "/census";
+    if (!applyRule(probe, GLR_CONWAY)) return RETVAL_BADARGS;
+    if (probe.rule().birth & 1) {
+        std::cerr << "a census needs a rule without B0" << std::endl;
+        return RETVAL_BADARGS;
+    }
+    GLCensus census(args_.width, args_.height, args_.nthreads);
+    census.setup([](GLBitMap& map) { setup(map); applyRule(map, GLR_CONWAY); });
+
+    auto start = clock::now();
+    census.run(soups, args_.gens);
+    std::chrono::duration<double> elapsed = clock::now() - start;
+
+    if (!census.save(catalogue)) std::cerr << "unable to write census: " << args_.catalogue << std::endl;
+
+    const GLTally& tally = census.tally();
+    size_t objects = 0;
+    for (auto& object : tally.objects) objects += object.second;
+    double sps = (elapsed.count() > 0) ? tally.soups / elapsed.count() : 0;
+    double gps = (elapsed.count() > 0) ? tally.gens / elapsed.count() : 0;
+    std::cout << "  engine = " << engine << "  ";
+    std::cout << "soup = " << args_.width << 'x' << args_.height << "  ";
+    std::cout << "rule = " << ruleString(probe.rule()) << "  ";
+    std::cout << "gens = " << args_.gens << "  ";
+    std::cout << "threads = " << census.threads() << '\n';
+    std::cout << std::string(80, '-') << '\n';
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  elapsed = " << elapsed.count() << " s  ";
+    std::cout << "speed = " << sps << " soup/s  " << sps / census.threads() << " soup/s/thread  ";
+    std::cout << std::scientific << gps * args_.width * args_.height << " cell/s\n";
+    std::cout << "  soups = " << tally.soups << "  settled = " << tally.settled << "  spilled = " << tally.spilled;
+    std::cout << "  unsettled = " << tally.soups - tally.settled - tally.spilled << '\n';
+    std::cout << "  objects = " << objects << "  distinct = " << tally.objects.size() << '\n';
+    std::cout << std::flush;
+    return RETVAL_EXIT;
+}
+
+#ifndef _WIN32
+/* every worker loads its own domain from the pattern mapped before the fork, or
+ * fills it with its part of the soup, and the elapsed time is the one of the
+ * slowest worker
+ */
+int domains() {
+    std::unique_ptr<GLPattern> pattern;
+    size_t width = args_.width, height = args_.height;
+    GLRule rule = GLR_CONWAY;
+    if (!args_.random) {
+        pattern.reset(new GLPattern());
+        if (!pattern->open(args_.fname.c_str())) {
+            std::cerr << "unable to open file: " << args_.fname << std::endl;
+            return RETVAL_ERROPEN;
+        }
+        if (!pattern->parse()) {
+            std::cerr << "bad file contents: " << args_.fname << std::endl;
+            return RETVAL_BADDATA;
+        }
+        width = pattern->width(), height = pattern->height(), rule = pattern->rule();
+        args_.boundless |= pattern->boundless();
+    }
+
+    std::string engine;
+    {
+        GLMap probe(1, 1);  //released before the fork, with its threads
+        engine = setup(probe) + "/domains";
+        if (!applyRule(probe, rule)) return RETVAL_BADARGS;
+    }
+
+    GLDomains domains(width, height, args_.cols, args_.rows);
+    auto load = [&pattern, rule](GLDomain& domain) {
+        setup(domain.map());
+        if (pattern && !pattern->load(domain, args_.seed)) return false;
+        if (!pattern) domain.init(args_.ratio, args_.seed);
+        return applyRule(domain, rule);
+    };
+    std::chrono::duration<double> saving{};
+    std::function<void(const GLDomains&)> frame;
+    if (!args_.snapshot.empty()) frame = [&saving](const GLDomains& done) {
+        auto start = std::chrono::steady_clock::now();
+        if (!snapshot(done)) std::cerr << "unable to write snapshot: " << args_.snapshot << std::endl;
+        saving += std::chrono::steady_clock::now() - start;
+    };
+    std::cout << std::flush;    //not written again by the workers
+    if (!domains.run(args_.gens, args_.boundless, load, args_.interval, frame)) {
+        std::cerr << domains.error() << std::endl;
+        return RETVAL_CMDFAIL;
+    }
+
+    double elapsed = domains.seconds(), gps = (elapsed > 0) ? args_.gens / elapsed : 0;
+    std::cout << "  engine = " << engine << "  ";
+    std::cout << "map = " << width << 'x' << height << "  ";
+    std::cout << "mode = " << ((args_.boundless) ? "boundless" : "bounded") << "  ";
+    std::cout << "rule = " << ruleString(domains.rule()) << "  ";
+    std::cout << "gens = " << domains.gen() << "  ";
+    std::cout << "domains = " << domains.cols() << 'x' << domains.rows() << "  ";
+    std::cout << "threads = " << args_.nthreads << '\n';
+    std::cout << std::string(80, '-') << '\n';
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  load = " << domains.loading() << " s  ";
+    std::cout << "elapsed = " << elapsed << " s  ";
+    std::cout << "speed = " << gps << " gen/s  ";
+    std::cout << std::scientific << gps * width * height << " cell/s\n";
+    std::cout << "  population = " << domains.population() << '\n';
+    std::cout << std::fixed << "  shared = " << domains.memory() / double(1 << 20) << " MiB\n";
+    if (snapshots_ > 0) std::cout << "  snapshots = " << snapshots_ << " in " << saving.count() << " s\n";
+    bounds(domains);
+    std::cout << std::flush;
+    return RETVAL_EXIT;
+}
+#else
+int domains() {
+    std::cerr << "domains need POSIX shared memory" << std::endl;
+    return RETVAL_BADARGS;
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    if (parseHelp(argc, argv)) {
+        std::cout << USAGE << std::endl;
+        return RETVAL_EXIT;
+    }
+    if (!parseArgs(argc, argv)) return RETVAL_BADARGS;
+    if (args_.ensemble) return ensemble();
+    if (args_.census) return census();
+    if (args_.cols) return domains();
+    switch (args_.engine) {
+    case ENGINE_BIT: return run<GLBitMap>();
+    case ENGINE_HASH: return run<GLHashLife>();
+    case ENGINE_SPARSE: return run<GLSparseMap>();
+    default: return run<GLMap>();
+    }
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "glmap.h"
+#include "glsnapshot.h"
+
+
+#define GLHS_DEFBUDGET  (64 << 20)  //bytes of recorded generations
+#define GLHS_KEYSPAN    64          //most generations recorded after a keyframe
+
+
+/* rewind history of a map within a memory budget:
+ * the cells are bit-packed as in GLBitMap, a keyframe holds all the words of a
+ * generation, and every other generation holds the XOR of its words with the
+ * previous one recorded, both as blocks of <varint zero words> <varint literal
+ * words> <literal words> like snapshots, so still regions cost almost nothing,
+ * a keyframe is taken once the deltas since the last one outgrow it, or after
+ * GLHS_KEYSPAN generations, which bounds the deltas applied by a seek,
+ * and the oldest keyframe with its deltas is dropped when over the budget
+ */
+class GLHistory {
+public:
+    explicit GLHistory(size_t budget = GLHS_DEFBUDGET) :_budget(budget), _pack(rowPack(detectKernel())) {}
+
+    size_t budget() const { return _budget; }
+    void budget(size_t bytes) { _budget = bytes; _evict(); }
+    size_t memory() const { return _memory; }
+    size_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+    size_t first() const { return _entries.front().gen; }
+    size_t last() const { return _entries.back().gen; }
+    bool contains(size_t gen) const { return _find(gen) < _entries.size(); }
+    void clear() { _entries.clear(); _memory = _keys = 0; }
+
+    void record(const GLMap& map);
+    bool fetch(size_t gen, std::vector<uint64_t>& words) const;
+    bool rewind(size_t gen, GLMap& map);
+
+private:
+    struct Entry {
+        size_t gen;
+        bool key;
+        std::vector<char> data;
+    };
+
+    size_t _budget;
+    size_t _width = 0, _height = 0, _nwords = 0;    //words per row
+    std::deque<Entry> _entries;
+    size_t _memory = 0, _keys = 0;
+    size_t _keysize = 0, _since = 0, _span = 0;     //bytes of the last keyframe, and of the deltas and generations after it
+    std::vector<uint64_t> _prev;    //the words of the last generation recorded
+    std::vector<uint64_t> _row, _lits;
+    std::vector<char> _buf;
+    GLRowPack _pack;
+
+    size_t _find(size_t gen) const;
+    void _push(Entry&& entry);
+    void _pop();
+    void _evict();
+    void _truncate(size_t gen);
+    static void _apply(const std::vector<char>& data, std::vector<uint64_t>& words);
+};
+
+/* index of the generation, or size() if it is not retained */
+inline size_t GLHistory::_find(size_t gen) const {
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), gen, [](const Entry& e, size_t g) { return e.gen < g; });
+    return (it != _entries.end() && it->gen == gen) ? size_t(it - _entries.begin()) : _entries.size();
+}
+
+inline void GLHistory::_push(Entry&& entry) {
+    _memory += entry.data.size();
+    _keys += entry.key;
+    if (entry.key) _keysize = entry.data.size(), _since = _span = 0;
+    else _since += entry.data.size(), _span++;
+    _entries.push_back(std::move(entry));
+}
+
+/* the oldest keyframe and its deltas */
+inline void GLHistory::_pop() {
+    do {
+        _memory -= _entries.front().data.size();
+        _keys -= _entries.front().key;
+        _entries.pop_front();
+    } while (!_entries.empty() && !_entries.front().key);
+}
+
+/* the latest keyframe is always kept, even over the budget */
+inline void GLHistory::_evict() {
+    while (_memory > _budget && _keys > 1) _pop();
+}
+
+/* drop gen and the later generations */
+inline void GLHistory::_truncate(size_t gen) {
+    while (!_entries.empty() && _entries.back().gen >= gen) {
+        _memory -= _entries.back().data.size();
+        _keys -= _entries.back().key;
+        _entries.pop_back();
+    }
+    _since = _span = 0;
+    for (auto it = _entries.rbegin(); it != _entries.rend(); ++it) {
+        if (it->key) { _keysize = it->data.size(); break; }
+        _since += it->data.size();
+        _span++;
+    }
+}
+
+/* XOR the blocks into the words */
+inline void GLHistory::_apply(const std::vector<char>& data, std::vector<uint64_t>& words) {
+    const unsigned char* p = (const unsigned char*)data.data(), * end = p + data.size();
+    auto varint = [&p]() {
+        uint64_t val = 0;
+        for (unsigned shift = 0; ; shift += 7) {
+            val |= uint64_t(*p & 0x7F) << shift;
+            if (!(*p++ & 0x80)) return val;
+        }
+    };
+    uint64_t* dst = words.data();
+    while (p < end) {
+        dst += varint();
+        for (uint64_t n = varint(); n > 0; n--, p += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, p, sizeof(uint64_t));
+            *dst++ ^= word;
+        }
+    }
+}
+
+/* rows are packed and encoded one at a time, while the row is still in cache,
+ * a generation not after the last one recorded replaces it and the later ones
+ */
+inline void GLHistory::record(const GLMap& map) {
+    if (map.width() != _width || map.height() != _height) {
+        clear();
+        _width = map.width();
+        _height = map.height();
+        _nwords = (_width + GLB_WORDBITS - 1) / GLB_WORDBITS;
+        _row.resize(_nwords);
+    }
+    if (!empty() && map.gen() <= last()) {
+        _truncate(map.gen());
+        if (!empty()) fetch(last(), _prev);
+    }
+    bool key = empty() || _since > _keysize || _span >= GLHS_KEYSPAN;
+    _prev.resize(_nwords * _height);
+
+    _buf.clear();
+    auto varint = [this](uint64_t val) {
+        for (; val >= 0x80; val >>= 7) _buf.push_back(char(val | 0x80));
+        _buf.push_back(char(val));
+    };
+    uint64_t zeros = 0;
+    auto block = [&]() {
+        varint(zeros);
+        varint(_lits.size());
+        const char* data = (const char*)_lits.data();
+        _buf.insert(_buf.end(), data, data + sizeof(uint64_t) * _lits.size());
+        zeros = 0;
+        _lits.clear();
+    };
+    uint64_t* prev = _prev.data();
+    for (size_t y = 0; y < _height; y++) {
+        _pack(map[y], _width, _row.data());
+        for (uint64_t word : _row) {
+            uint64_t delta = (key) ? word : word ^ *prev;
+            *prev = word;
+            if (delta) _lits.push_back(delta);
+            else if (_lits.empty()) zeros++;
+            else block(), zeros = 1;
+            prev++;
+        }
+    }
+    if (zeros || !_lits.empty()) block();
+
+    _push({ map.gen(), key, std::vector<char>(_buf.begin(), _buf.end()) });
+    _evict();
+}
+
+/* from the keyframe at or before the generation */
+inline bool GLHistory::fetch(size_t gen, std::vector<uint64_t>& words) const {
+    size_t idx = _find(gen), key = idx;
+    if (idx == _entries.size()) return false;
+    while (!_entries[key].key) key--;
+    words.assign(_nwords * _height, 0);
+    for (size_t i = key; i <= idx; i++) _apply(_entries[i].data, words);
+    return true;
+}
+
+/* the map goes back to the generation, and the later ones are dropped, as they
+ * will be recorded again when the map steps forward
+ */
+inline bool GLHistory::rewind(size_t gen, GLMap& map) {
+    if (map.width() != _width || map.height() != _height || !fetch(gen, _prev)) return false;
+    const uint64_t* words = _prev.data();
+    for (size_t y = 0; y < _height; y++)
+        for (size_t x = 0; x < _width; x += GLB_WORDBITS) unpackWord(*words++, std::min<size_t>(GLB_WORDBITS, _width - x), map[y] + x);
+    map.touch();
+    map.gen(gen);
+    _truncate(gen + 1);
+    return true;
+}
@@ -0,0 +1,640 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <memory>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "glpool.h"
+#include "glsimd.h"
+#include "glstore.h"
+
+
+#define GLM_DEFMAPW     100
+#define GLM_DEFMAPH     100
+#define GLM_DEFRATIO    0.25
+
+#define GLM_FLAT        0
+#define GLM_PADDED      1
+
+#define GLM_TILESIZE    (1 << GLK_CHUNKBITS)   //the change flags of row kernels are per tile
+#define GLM_STRIPSIZE   (8 << 20)   //bytes of rows read ahead and written behind at once by mapped maps
+
+#define GLM_CYCLEOFF    0
+#define GLM_CYCLEFIND   1
+#define GLM_CYCLESTOP   2
+#define GLM_CYCLESKIP   3
+
+#define GLM_HISTORY     1024    //generations searched for a repeated state
+
+#define GLM_SOUPBITS    15      //precision of the ratio of random soups
+
+#define GLDT_RATIO      0
+#define GLDT_BITMAP     1
+#define GLDT_COORD      2
+#define GLDT_RECT       3
+
+
+/* portable replacements of the Win32 POINT and RECT */
+struct GLPoint { long x, y; };
+struct GLRect { long left, top, right, bottom; };
+
+/* statistics of a generation, the births and deaths are since the previous one,
+ * the bounding box is empty (left == right) without alive cells
+ */
+struct GLStats {
+    size_t gen = 0, population = 0, births = 0, deaths = 0;
+    GLRect bbox = { LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN };
+
+    GLStats& operator+=(const GLStats& rhs);
+};
+
+inline GLStats& GLStats::operator+=(const GLStats& rhs) {
+    population += rhs.population;
+    births += rhs.births;
+    deaths += rhs.deaths;
+    bbox.left = std::min(bbox.left, rhs.bbox.left);
+    bbox.top = std::min(bbox.top, rhs.bbox.top);
+    bbox.right = std::max(bbox.right, rhs.bbox.right);
+    bbox.bottom = std::max(bbox.bottom, rhs.bbox.bottom);
+    return *this;
+}
+
+/* random soup, each cell alive with the probability of the ratio:
+ * every row draws from its own splitmix64 stream seeded by the seed and the row,
+ * four cells per draw, so the rows can be filled in any order by any number of
+ * threads, and all engines get the same soup for the same seed,
+ * the four 16-bit lanes of a draw are compared at once, each lane keeping its
+ * top bit free for the borrow
+ */
+class GLSoup {
+public:
+    GLSoup(float ratio, unsigned seed)
+        :_seed(_mix(seed)), _threshold(uint64_t(std::min(std::abs(ratio), 1.0f) * (1 << GLM_SOUPBITS) + 0.5f) * _lanes) {}
+
+    void row(size_t y, bool cells[], size_t width, size_t left = 0) const;  //the cells from column left
+    void row(size_t y, uint64_t words[], size_t width) const;   //64 cells per word, the padding bits zero
+
+private:
+    static constexpr uint64_t _lanes = 0x0001000100010001ull;
+    static constexpr uint64_t _borrow = _lanes << GLM_SOUPBITS;
+    static constexpr uint64_t _gamma = 0x9e3779b97f4a7c15ull;   //the increment of the stream per draw
+    uint64_t _seed;
+    uint64_t _threshold;    //per lane
+
+    static uint64_t _mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    /* the top bit of each lane is set for the alive cells */
+    uint64_t _draw(uint64_t& state) const { return ~((_mix(state += _gamma) | _borrow) - _threshold) & _borrow; }
+};
+
+/* a draw covers 4 columns, so the stream skips the draws before left */
+inline void GLSoup::row(size_t y, bool cells[], size_t width, size_t left /*0*/) const {
+    uint64_t state = _mix(_seed + y) + left / 4 * _gamma;
+    size_t x = 0;
+    if (left % 4) {
+        uint64_t alive = _draw(state) >> (GLM_SOUPBITS + left % 4 * 16);
+        for (; x < width && (left + x) % 4; x++, alive >>= 16) cells[x] = alive & 1;
+        cells += x, width -= x, x = 0;
+    }
+    for (; x + 4 <= width; x += 4) {
+        uint64_t alive = _draw(state) >> GLM_SOUPBITS;
+        uint32_t bytes = uint32_t((alive & 1) | ((alive >> 8) & 0x100) | ((alive >> 16) & 0x10000) | ((alive >> 24) & 0x1000000));
+        memcpy(cells + x, &bytes, 4);
+    }
+    for (uint64_t alive = _draw(state) >> GLM_SOUPBITS; x < width; x++, alive >>= 16) cells[x] = alive & 1;
+}
+
+inline void GLSoup::row(size_t y, uint64_t words[], size_t width) const {
+    uint64_t state = _mix(_seed + y);
+    for (size_t x = 0; x < width; x += 64) {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64 && x + j < width; j += 4) {
+            uint64_t alive = _draw(state) >> GLM_SOUPBITS;
+            word |= ((alive & 1) | ((alive >> 15) & 2) | ((alive >> 30) & 4) | ((alive >> 45) & 8)) << j;
+        }
+        *words++ = (width - x < 64) ? word & ((uint64_t(1) << (width - x)) - 1) : word;
+    }
+}
+
+/* layouts of GLMap:
+ *   Flat: rows are stored contiguously, the edges are resolved per cell
+ * Padded: every row and column is surrounded by a one-cell halo, refreshed once
+ *         per generation from the map mode, so every cell takes the row kernel
+ *
+ * cycle modes of GLMap:
+ *  Off: no hashing
+ * Find: a Zobrist-style hash of the map, keyed per 8 cells, is updated from the
+ *       computed spans of every generation, and a hash repeated within the last
+ *       GLM_HISTORY generations gives the period and the first generation of the
+ *       cycle, collisions of the 64-bit hash are ignored
+ * Stop: as Find, and next() does nothing once a cycle is found
+ * Skip: as Find, and next() jumps over whole periods once a cycle is found
+ *
+ * with tally on, next() counts the population, births, deaths and bounding box
+ * of every row right after the kernel writes it, the tiles not computed are
+ * still the same in both buffers, tally(true) counts again after cells are written
+ *
+ * cells written through operator[] must be followed by touch()
+ *
+ * with exchange(fill), the halo of a padded map is filled by fill() before every
+ * generation instead of from the map mode, for a map stepped as a sub-domain of a
+ * larger one, halo(row) gives row -1 to height with columns -1 to width, and the
+ * tiles and cycles only see the cells of the map itself
+ *
+ * with a directory given, both buffers are kept in temporary files of it mapped
+ * into memory instead of the heap, for maps larger than memory, and next() walks
+ * every band in strips of GLM_STRIPSIZE bytes, reading the front rows of the next
+ * strip ahead, starting to write the back rows of the previous one, and releasing
+ * both buffers 3 strips behind, so the pages kept stay few and the files are read
+ * and written in order
+ */
+class GLMap {
+public:
+    GLMap(size_t width, size_t height, const std::string& dir = std::string())
+        :_width(width), _height(height), _gen(0), _pad(0), _dir(dir), _boundless(false),
+        _tw((width + GLM_TILESIZE - 1) / GLM_TILESIZE), _th((height + GLM_TILESIZE - 1) / GLM_TILESIZE) { _alloc(); kernel(GLK_AVX2); }
+    GLMap(const GLMap&) = delete;
+    GLMap(GLMap&&) = delete;
+    ~GLMap() { _free(); }
+
+    bool* operator[](size_t row) { return _mfront + (row + _pad) * _stride + _pad; }
+    const bool* operator[](size_t row) const { return _mfront + (row + _pad) * _stride + _pad; }
+
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    size_t gen() const { return _gen; }
+    void gen(size_t gen) { _gen = gen; _forget(); }
+    bool valid(size_t x, size_t y) const { return (x < _width && y < _height); }
+    bool mapped() const { return _sfront != nullptr; }
+    size_t population() const;
+    bool bounds(GLRect& rect) const;
+    size_t threads() const { return (_pool) ? _pool->size() : 1; }
+    void threads(size_t nthreads) { _pool.reset((nthreads > 1) ? new GLPool(nthreads) : nullptr); }
+    int kernel() const { return _level; }
+    void kernel(int level) { _level = std::min(std::max(level, GLK_SCALAR), detectKernel()); _kernel = rowKernel(_level, _rule.conway()); _counter = rowCount(_level); }
+    const GLRule& rule() const { return _rule; }
+    void rule(const GLRule& rule) { _rule = rule; kernel(_level); touch(); }
+    int layout() const { return (_pad) ? GLM_PADDED : GLM_FLAT; }
+    void layout(int layout);
+    bool tiles() const { return !_changed.empty(); }
+    void tiles(bool enable) { _changed.assign(enable * _tw * _th, true); _active.assign(enable * _tw * _th, true); _dirty.assign(enable * _tw * _th, true); }
+    size_t active() const { return std::count(_active.begin(), _active.end(), true); }
+    const std::vector<char>& dirty() const { return _dirty; }  //per tile, changed since the last clean(), tiles only
+    void clean() { std::fill(_dirty.begin(), _dirty.end(), false); }
+    void touch() { std::fill(_changed.begin(), _changed.end(), true); std::fill(_dirty.begin(), _dirty.end(), true); _forget(); }
+    void touch(size_t x, size_t y) { _forget(); if (tiles() && valid(x, y)) _changed[y / GLM_TILESIZE * _tw + x / GLM_TILESIZE] = _dirty[y / GLM_TILESIZE * _tw + x / GLM_TILESIZE] = true; }
+    int cycles() const { return _cmode; }
+    void cycles(int mode) { _cmode = std::min(std::max(mode, GLM_CYCLEOFF), GLM_CYCLESKIP); _forget(); }
+    size_t period() const { return _period; }
+    size_t entry() const { return _entry; }
+    bool tally() const { return _tally; }
+    void tally(bool enable) { _tally = enable; if (enable) _census(); }
+    const GLStats& stats() const { return _stats; }
+    bool* halo(long row) { return _mfront + (row + 1) * _stride + 1; }    //padded layout only
+    bool cell(size_t x, size_t y, bool boundless) const { return _cell(x, y, boundless); }  //the next state by the per-cell path, the reference of the kernels
+    void exchange(const std::function<void(GLMap&)>& fill) { _exchange = fill; touch(); }
+    size_t memory() const { return (2 * _msize + _width) * sizeof(bool) + _changed.size() + _active.size() + _dirty.size() + _history.size() * sizeof(uint64_t); }
+
+    void init();
+    void init(float ratio, unsigned seed = std::minstd_rand::default_seed);
+    void init(const bool map[], size_t size);
+    void init(const GLPoint coord[], size_t size);
+    void init(const GLRect rect[], size_t size);
+    void next(bool boundless = false) { next(boundless, 1); }
+    void next(bool boundless, size_t gens);
+
+private:
+    size_t _width, _height, _gen;
+    size_t _pad, _stride, _msize;   //halo width, row stride and buffer size of the layout
+    bool* _mfront, * _mback;
+    bool* _mzero;   //a dead row used as the outer rows of bounded flat maps
+    std::string _dir;   //of the files of mapped buffers, empty for the heap
+    std::unique_ptr<GLStore> _sfront, _sback;   //the files of the buffers, if mapped
+    bool _boundless;    //the map mode of the last generation
+    size_t _tw, _th;    //number of tiles in a row and in a column
+    std::vector<char> _changed, _active;    //per tile, changed in the last generation and computed in the next one
+    std::vector<char> _dirty;   //per tile, changed in any generation since the last clean()
+    std::unique_ptr<GLPool> _pool;
+    GLRowKernel _kernel;
+    GLRowCount _counter;
+    int _level;
+    GLRule _rule = GLR_CONWAY;
+    int _cmode = GLM_CYCLEOFF;
+    bool _hashed = false;   //the hash matches the front buffer
+    uint64_t _hash = 0;
+    size_t _period = 0, _entry = 0;     //the cycle found, period 0 for none
+    size_t _hfirst = 0;     //the first generation in the history
+    std::vector<uint64_t> _history;     //hashes of recent generations, by generation modulo GLM_HISTORY
+    bool _tally = false;
+    GLStats _stats;
+    std::function<void(GLMap&)> _exchange;  //fills the halo of a sub-domain
+
+    void _alloc();
+    void _free();
+    size_t _offset(size_t x, size_t y) const { return (x + _width) % _width + _pad + ((y + _height) % _height + _pad) * _stride; }
+    void _halo(bool boundless);
+    void _stream(size_t y, size_t top) const;
+    bool _cell(size_t x, size_t y, bool boundless) const;
+    void _span(size_t y, size_t left, size_t right, bool boundless, char* changed = nullptr);
+    uint64_t _band(size_t top, size_t bottom, bool boundless, GLStats& stats);
+    void _activate(bool boundless);
+    uint64_t _tileband(size_t top, size_t bottom, bool boundless, GLStats& stats);
+    void _forget() { _hashed = false; _period = _entry = 0; }
+    uint64_t _zobrist(uint64_t word, size_t x, size_t y) const;
+    uint64_t _word(const bool* row, size_t x) const;
+    uint64_t _delta(size_t y, size_t left, size_t right) const;
+    void _rehash();
+    void _record();
+    void _count(const bool* now, const bool* before, size_t y, size_t left, size_t right, GLStats& stats) const;
+    void _census();
+};
+
+inline void GLMap::_alloc() {
+    _stride = _width + 2 * _pad;
+    _msize = _stride * (_height + 2 * _pad);
+    if (_dir.empty()) {
+        _mfront = new bool[_msize]();
+        _mback = new bool[_msize]();
+    } else {
+        _sfront.reset(new GLStore());
+        _sback.reset(new GLStore());
+        if (!_sfront->open(_dir, _msize) || !_sback->open(_dir, _msize)) throw std::runtime_error("unable to map a file in " + _dir);
+        _mfront = _sfront->data();
+        _mback = _sback->data();
+    }
+    _mzero = new bool[_width]();
+}
+
+inline void GLMap::_free() {
+    if (!_sfront) delete[] _mfront, delete[] _mback;
+    _sfront.reset();
+    _sback.reset();
+    delete[] _mzero;
+}
+
+inline void GLMap::layout(int layout) {
+    size_t pad = (layout == GLM_PADDED) ? 1 : 0;
+    if (pad == _pad) return;
+
+    bool* mfront = _mfront, * mback = _mback, * mzero = _mzero;
+    std::unique_ptr<GLStore> sfront = std::move(_sfront), sback = std::move(_sback);
+    size_t stride = _stride;
+    _pad = pad;
+    _alloc();
+    for (size_t row = 0; row < _height; row++) {    //keep the map content
+        memcpy((*this)[row], mfront + (row + 1 - _pad) * stride + (1 - _pad), sizeof(bool) * _width);
+    }
+    if (!sfront) delete[] mfront, delete[] mback;
+    delete[] mzero;
+    touch();    //the back buffer is no longer in sync
+}
+
+inline size_t GLMap::population() const {
+    size_t cnt = 0;
+    for (size_t row = 0; row < _height; row++) cnt += std::count((*this)[row], (*this)[row] + _width, true);
+    return cnt;
+}
+
+/* the smallest rectangle containing all alive cells, false if there is none,
+ * rows are searched by memchr() from the west, and 8 cells at a time from the east
+ */
+inline bool GLMap::bounds(GLRect& rect) const {
+    rect = { long(_width), long(_height), 0, 0 };
+    for (size_t y = 0; y < _height; y++) {
+        const bool* row = (*this)[y];
+        const void* first = memchr(row, true, _width);
+        if (!first) continue;
+        long left = long((const bool*)first - row), right = long(_width);
+        for (uint64_t word = 0; right - left >= 8; right -= 8) {
+            memcpy(&word, row + right - 8, 8);
+            if (word) break;
+        }
+        while (!row[right - 1]) right--;
+        rect.left = std::min(rect.left, left);
+        rect.right = std::max(rect.right, right);
+        rect.top = std::min(rect.top, long(y));
+        rect.bottom = long(y) + 1;
+    }
+    return rect.left < rect.right;
+}
+
+inline void GLMap::init() {
+    _gen = 0;
+    if (_sfront) _sfront->zero();
+    else memset(_mfront, 0, sizeof(bool) * _msize);
+    touch();
+}
+
+/* split into bands of rows like next(), the soup does not depend on the bands */
+inline void GLMap::init(float ratio, unsigned seed /*std::minstd_rand::default_seed*/) {
+    init();
+    GLSoup soup(ratio, seed);
+    size_t nbands = (_pool) ? std::min(_pool->size(), _height) : 1;
+    std::function<void(size_t)> band = [this, &soup, nbands](size_t i) {
+        for (size_t y = _height * i / nbands; y < _height * (i + 1) / nbands; y++) soup.row(y, (*this)[y], _width);
+    };
+    if (_pool) _pool->run(nbands, band);
+    else band(0);
+}
+
+inline void GLMap::init(const bool map[], size_t size) {
+    init();
+    for (size_t row = 0; row < _height && row * _width < size; row++) {
+        memcpy((*this)[row], map + row * _width, sizeof(bool) * std::min(size - row * _width, _width));
+    }
+}
+
+inline void GLMap::init(const GLPoint coord[], size_t size) {
+    init();
+    for (size_t i = 0; i < size; i++) {
+        auto& pt = coord[i];
+        if (valid(pt.x, pt.y)) (*this)[pt.y][pt.x] = true;
+    }
+}
+
+inline void GLMap::init(const GLRect rect[], size_t size) {
+    init();
+    for (size_t i = 0; i < size; i++) {
+        long left = std::max(rect[i].left, 0L), right = std::min(rect[i].right, (long)_width);
+        long top = std::max(rect[i].top, 0L), bottom = std::min(rect[i].bottom, (long)_height);
+        for (long row = top; left < right && row < bottom; row++) {
+            memset(&(*this)[row][left], 1, sizeof(bool) * (right - left));
+        }
+    }
+}
+
+/* refresh the halo of a padded map, dead cells for bounded maps,
+ * or the opposite edges for boundless maps (corners included)
+ */
+inline void GLMap::_halo(bool boundless) {
+    bool* top = _mfront, * bottom = _mfront + (_height + 1) * _stride;
+    if (boundless) {
+        memcpy(top + 1, (*this)[_height - 1], sizeof(bool) * _width);
+        memcpy(bottom + 1, (*this)[0], sizeof(bool) * _width);
+    } else {
+        memset(top, 0, sizeof(bool) * _stride);
+        memset(bottom, 0, sizeof(bool) * _stride);
+    }
+    for (bool* row = top; row <= bottom; row += _stride) {
+        row[0] = boundless && row[_width];
+        row[_width + 1] = boundless && row[1];
+    }
+}
+
+inline bool GLMap::_cell(size_t x, size_t y, bool boundless) const {
+    size_t cnt = 0;
+
+    cnt += (boundless || valid(x - 1, y - 1)) && _mfront[_offset(x - 1, y - 1)];
+    cnt += (boundless || valid(x, y - 1)) && _mfront[_offset(x, y - 1)];
+    cnt += (boundless || valid(x + 1, y - 1)) && _mfront[_offset(x + 1, y - 1)];
+    cnt += (boundless || valid(x - 1, y)) && _mfront[_offset(x - 1, y)];
+    cnt += (boundless || valid(x + 1, y)) && _mfront[_offset(x + 1, y)];
+    cnt += (boundless || valid(x - 1, y + 1)) && _mfront[_offset(x - 1, y + 1)];
+    cnt += (boundless || valid(x, y + 1)) && _mfront[_offset(x, y + 1)];
+    cnt += (boundless || valid(x + 1, y + 1)) && _mfront[_offset(x + 1, y + 1)];
+
+    return _rule((*this)[y][x], cnt);
+}
+
+/* the inner cells of a row are computed by the row kernel, while the west and
+ * east edges of flat maps take the per-cell path for bounds and wrapping
+ */
+inline void GLMap::_span(size_t y, size_t left, size_t right, bool boundless, char* changed /*nullptr*/) {
+    bool* dst = _mback + (y + _pad) * _stride + _pad;
+    const bool* mid = (*this)[y];
+    if (_pad) {     //the halo is always readable
+        _kernel(dst, mid - _stride, mid, mid + _stride, left, right, changed, _rule);
+        return;
+    }
+
+    const bool* up = (y > 0) ? (*this)[y - 1] : (boundless) ? (*this)[_height - 1] : _mzero;
+    const bool* down = (y + 1 < _height) ? (*this)[y + 1] : (boundless) ? (*this)[0] : _mzero;
+    size_t begin = std::max<size_t>(left, 1), end = std::min(right, _width - 1);
+    if (begin < end) _kernel(dst, up, mid, down, begin, end, changed, _rule);
+    if (left == 0) dst[0] = _cell(0, y, boundless);
+    if (right == _width) dst[_width - 1] = _cell(_width - 1, y, boundless);
+    if (changed && left == 0) changed[0] |= dst[0] != mid[0];
+    if (changed && right == _width) changed[(_width - 1) / GLM_TILESIZE] |= dst[_width - 1] != mid[_width - 1];
+}
+
+/* at the first row of every strip of a band from top, the rows before the band
+ * are left to the band that computes them
+ */
+inline void GLMap::_stream(size_t y, size_t top) const {
+    size_t strip = std::max<size_t>(GLM_STRIPSIZE / _stride, 1);
+    if (!_sfront || (y - top) % strip) return;
+    size_t bytes = strip * _stride, offset = (y + _pad) * _stride;
+    if (y == top) _sfront->prefetch(offset, 2 * bytes);
+    else _sfront->prefetch(offset + bytes, bytes);
+    if (y - top >= strip) _sback->flush(offset - bytes, bytes);
+    if (y - top >= 3 * strip) _sfront->release(offset - 3 * bytes, bytes), _sback->release(offset - 3 * bytes, bytes);
+}
+
+/* the change of the hash is returned, 0 if cycles are not tracked */
+inline uint64_t GLMap::_band(size_t top, size_t bottom, bool boundless, GLStats& stats) {
+    uint64_t delta = 0;
+    for (size_t y = top; y < bottom; y++) {
+        _stream(y, top);
+        _span(y, 0, _width, boundless);
+        if (_cmode) delta ^= _delta(y, 0, _width);
+        if (_tally) _count(_mback + (y + _pad) * _stride + _pad, (*this)[y], y, 0, _width, stats);
+    }
+    return delta;
+}
+
+/* the key of 8 cells of a row starting at x, a multiple of 8, the splitmix64 finalizer
+ * of their states and position, so the hash of a map is the exclusive or of the keys of all its words
+ */
+inline uint64_t GLMap::_zobrist(uint64_t word, size_t x, size_t y) const {
+    uint64_t z = word ^ ((uint64_t(y) * _stride + x) * 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* 8 cells of a row as a word, the ones past the end are dead */
+inline uint64_t GLMap::_word(const bool* row, size_t x) const {
+    uint64_t word = 0;
+    memcpy(&word, row + x, std::min<size_t>(_width - x, 8));
+    return word;
+}
+
+/* the hash change of a computed span, both keys of every word are always mixed since
+ * branching on the changed words mispredicts on busy maps
+ */
+inline uint64_t GLMap::_delta(size_t y, size_t left, size_t right) const {
+    const bool* dst = _mback + (y + _pad) * _stride + _pad, * src = (*this)[y];
+    uint64_t delta = 0;
+    size_t x = left;
+    for (; x + 8 <= right; x += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + x, 8);
+        memcpy(&b, src + x, 8);
+        delta ^= _zobrist(a, x, y) ^ _zobrist(b, x, y);
+    }
+    if (x < right) delta ^= _zobrist(_word(dst, x), x, y) ^ _zobrist(_word(src, x), x, y);
+    return delta;
+}
+
+/* hash the whole front buffer and restart the history from the current generation */
+inline void GLMap::_rehash() {
+    _hash = 0;
+    for (size_t y = 0; y < _height; y++)
+        for (size_t x = 0; x < _width; x += 8) _hash ^= _zobrist(_word((*this)[y], x), x, y);
+    _history.assign(GLM_HISTORY, 0);
+    _hfirst = _gen;
+    _history[_gen % GLM_HISTORY] = _hash;
+    _hashed = true;
+}
+
+/* look the hash of the current generation up in the history, the most recent match
+ * gives the shortest period, then record it
+ */
+inline void GLMap::_record() {
+    size_t oldest = std::max(_hfirst, (_gen > GLM_HISTORY) ? _gen - GLM_HISTORY : 0);
+    for (size_t g = _gen; !_period && g > oldest;) {
+        g--;
+        if (_history[g % GLM_HISTORY] == _hash) _period = _gen - g, _entry = g;
+    }
+    _history[_gen % GLM_HISTORY] = _hash;
+}
+
+/* a tile is computed only if itself or any of its neighbours changed in the last
+ * generation, otherwise both buffers already hold its content of the next one
+ */
+inline void GLMap::_activate(bool boundless) {
+    for (size_t ty = 0; ty < _th; ty++) {
+        for (size_t tx = 0; tx < _tw; tx++) {
+            bool active = false;
+            for (size_t dy = 0; dy < 3; dy++) {
+                for (size_t dx = 0; dx < 3; dx++) {
+                    size_t nx = tx + dx - 1, ny = ty + dy - 1;  //wrap around for boundless maps
+                    if (boundless) nx = (nx + _tw) % _tw, ny = (ny + _th) % _th;
+                    active |= (nx < _tw && ny < _th) && _changed[ny * _tw + nx];
+                }
+            }
+            _active[ty * _tw + tx] = active;
+        }
+    }
+}
+
+/* rows are still walked in order over the runs of adjacent active tiles to keep
+ * the memory access sequential, while the row kernel flags the changed tiles,
+ * which stay dirty over the generations until a reader such as a mipmap cleans them
+ */
+inline uint64_t GLMap::_tileband(size_t top, size_t bottom, bool boundless, GLStats& stats) {
+    uint64_t delta = 0;
+    for (size_t ty = top; ty < bottom; ty++) {
+        char* changed = &_changed[ty * _tw];
+        const char* active = &_active[ty * _tw];
+        std::fill(changed, changed + _tw, false);
+
+        for (size_t y = ty * GLM_TILESIZE; y < std::min((ty + 1) * GLM_TILESIZE, _height); y++) {
+            _stream(y, top * GLM_TILESIZE);
+            for (size_t begin = 0, end; begin < _tw; begin = end) {
+                if (!active[begin]) { end = begin + 1; continue; }
+                for (end = begin; end < _tw && active[end]; end++);
+                size_t left = begin * GLM_TILESIZE, right = std::min(end * GLM_TILESIZE, _width);
+                _span(y, left, right, boundless, changed);
+                if (_cmode) delta ^= _delta(y, left, right);
+            }
+            if (_tally) _count(_mback + (y + _pad) * _stride + _pad, (*this)[y], y, 0, _width, stats);
+        }
+        for (size_t tx = 0; tx < _tw; tx++) _dirty[ty * _tw + tx] |= changed[tx];
+    }
+    return delta;
+}
+
+/* per span, the bounding box only looks for the first and the last alive cells */
+inline void GLMap::_count(const bool* now, const bool* before, size_t y, size_t left, size_t right, GLStats& stats) const {
+    size_t counts[3] = {};
+    _counter(now, before, left, right, counts);
+    stats.population += counts[0];
+    stats.births += counts[1];
+    stats.deaths += counts[2];
+    if (!counts[0]) return;
+    long first = long(std::find(now + left, now + right, true) - now), last = long(right);
+    while (!now[last - 1]) last--;
+    stats.bbox.left = std::min(stats.bbox.left, first);
+    stats.bbox.right = std::max(stats.bbox.right, last);
+    stats.bbox.top = std::min(stats.bbox.top, long(y));
+    stats.bbox.bottom = std::max(stats.bbox.bottom, long(y) + 1);
+}
+
+/* a full pass giving the statistics of the current generation */
+inline void GLMap::_census() {
+    _stats = {};
+    for (size_t y = 0; y < _height; y++) _count((*this)[y], (*this)[y], y, 0, _width, _stats);
+    _stats.gen = _gen;
+    if (!_stats.population) _stats.bbox = {};
+}
+
+/* several generations in one call, reusing the buffers and the thread pool,
+ * the bands return their hash changes, which are combined once all of them are done
+ */
+inline void GLMap::next(bool boundless, size_t gens) {
+    if (boundless != _boundless) touch();   //the edges follow different rules
+    _boundless = boundless;
+
+    size_t rows = (tiles()) ? _th : _height;
+    auto task = [this, boundless](size_t top, size_t bottom, GLStats& stats) {
+        return (tiles()) ? _tileband(top, bottom, boundless, stats) : _band(top, bottom, boundless, stats);
+    };
+    size_t nbands = (_pool) ? std::min(_pool->size(), rows) : 1;
+    std::vector<uint64_t> deltas(nbands);
+    std::vector<GLStats> stats(nbands);
+    std::function<void(size_t)> band = [&task, &deltas, &stats, rows, nbands](size_t i) {
+        stats[i] = {};
+        deltas[i] = task(rows * i / nbands, rows * (i + 1) / nbands, stats[i]);
+    };
+
+    if (_cmode && !_hashed) _rehash();
+    for (size_t g = 0; g < gens; g++) {
+        if (_period && _cmode == GLM_CYCLESTOP) break;
+        if (_period && _cmode == GLM_CYCLESKIP) {   //the map is the same after whole periods
+            size_t skip = (gens - g) / _period * _period;
+            _gen += skip;
+            _stats.gen = _gen;
+            g += skip;
+            if (g == gens) break;
+        }
+
+        if (_pad && _exchange) _exchange(*this);
+        else if (_pad) _halo(boundless);
+        if (tiles()) _activate(boundless);
+        if (_pool) _pool->run(nbands, band);    //split rows into bands, the wrap-around rows only read the front buffer
+        else band(0);
+        std::swap(_mfront, _mback);
+        std::swap(_sfront, _sback);
+        _gen++;
+
+        if (_tally) {
+            _stats = {};
+            for (auto& part : stats) _stats += part;
+            _stats.gen = _gen;
+            if (!_stats.population) _stats.bbox = {};
+        }
+
+        if (!_cmode) continue;
+        for (uint64_t delta : deltas) _hash ^= delta;
+        _record();
+    }
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "glmap.h"
+#include "glsimd.h"
+#include "glbitmap.h"
+
+
+#define GLMM_BASE       2       //log2 of the side of the smallest blocks counted, a nibble of a row word
+#define GLMM_TRACK      5       //log2 of the side of the blocks tracked as dirty
+
+static_assert(GLM_TILESIZE % GLB_WORDBITS == 0, "a tile of the map packs into whole words");
+
+
+/* pyramid of the alive cells in square blocks of a map:
+ * level k counts the cells of blocks of 2^k x 2^k cells, from GLMM_BASE up to a
+ * single block holding the whole map, the levels below GLMM_BASE are summed from
+ * the cells on demand,
+ * update() takes the tiles the map found dirty since the last update, and compares
+ * only their cells with those counted last time, kept packed as bits, so that
+ * a still map costs nothing, a map without tiles is compared whole,
+ * only the base blocks of the cells that changed take the changes, they are tracked
+ * by the larger blocks of GLMM_TRACK, so that a soup changing everywhere is not
+ * tracked block by block, and the tracked blocks and their parents are summed again,
+ * every block from GLMM_TRACK up is stamped with the last update changing it, so
+ * copy() brings an older copy up to date by walking down from the top block into
+ * the blocks changed since that copy only
+ */
+class GLMipmap {
+public:
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    size_t levels() const { return _top + 1; }
+    size_t memory() const;
+    void clear();
+
+    void update(GLMap& map);
+    void copy(const GLMipmap& from);
+    uint32_t count(size_t level, size_t bx, size_t by) const;
+    uint32_t area(size_t level, size_t bx, size_t by) const;
+
+private:
+    size_t _width = 0, _height = 0, _top = 0;  //the level of a single block
+    size_t _track = 0;          //GLMM_TRACK, or the top level
+    size_t _words = 0;          //of a row of cells
+    size_t _version = 0;        //of the last update, or of the mipmap copied
+    size_t _since = 0;          //the update counting the whole map
+    std::vector<uint64_t> _cells, _row;     //as counted, and a row of the map being counted
+    GLRowPack _pack = rowPack(detectKernel());
+    std::vector<std::vector<uint32_t>> _counts; //from GLMM_BASE to _top
+    std::vector<std::vector<size_t>> _dirty;    //blocks counted again, per level
+    std::vector<std::vector<size_t>> _stamps;   //update last changing the blocks, from _track
+
+    size_t _cols(size_t level) const { return (_width + (size_t(1) << level) - 1) >> level; }
+    size_t _rows(size_t level) const { return (_height + (size_t(1) << level) - 1) >> level; }
+    static uint64_t _nibbles(uint64_t word);
+    void _reset(size_t width, size_t height);
+    void _mark(size_t level, size_t idx);
+    void _sum(size_t level, size_t bx, size_t by);
+    void _compare(const GLMap& map, size_t y, size_t begin, size_t end);
+    void _copy(const GLMipmap& from, size_t level, size_t bx, size_t by);
+};
+
+inline size_t GLMipmap::memory() const {
+    size_t bytes = (_cells.size() + _row.size()) * sizeof(uint64_t);
+    for (auto& counts : _counts) bytes += counts.size() * sizeof(uint32_t);
+    for (auto& stamps : _stamps) bytes += stamps.size() * sizeof(size_t);
+    return bytes;
+}
+
+/* the version goes on, so that no copy takes a later mipmap for its own */
+inline void GLMipmap::clear() {
+    _width = _height = _top = _words = 0;
+    std::vector<uint64_t>().swap(_cells);
+    std::vector<uint64_t>().swap(_row);
+    _counts.clear();
+    _dirty.clear();
+    _stamps.clear();
+}
+
+/* every 4 bits hold the alive cells of the same 4 bits, i.e. of a row of a base block */
+inline uint64_t GLMipmap::_nibbles(uint64_t word) {
+    word -= (word >> 1) & 0x5555555555555555ULL;
+    return (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+}
+
+inline void GLMipmap::_reset(size_t width, size_t height) {
+    clear();
+    _width = width;
+    _height = height;
+    _since = _version;
+    while ((size_t(1) << _top) < std::max(width, height)) _top++;
+    _top = std::max<size_t>(_top, GLMM_BASE);
+    _track = std::min<size_t>(std::max(GLMM_TRACK, GLMM_BASE), _top);
+    _words = (width + GLB_WORDBITS - 1) / GLB_WORDBITS;
+    _cells.assign(_words * height, 0);
+    _row.assign(_words, 0);
+    _counts.resize(_top + 1 - GLMM_BASE);
+    _dirty.resize(_counts.size());
+    _stamps.resize(_counts.size());
+    for (size_t k = GLMM_BASE; k <= _top; k++) {
+        _counts[k - GLMM_BASE].assign(_cols(k) * _rows(k), 0);
+        _stamps[k - GLMM_BASE].assign((k >= _track) ? _cols(k) * _rows(k) : 0, 0);
+    }
+}
+
+inline void GLMipmap::_mark(size_t level, size_t idx) {
+    size_t& stamp = _stamps[level - GLMM_BASE][idx];
+    if (stamp != _version) stamp = _version, _dirty[level - GLMM_BASE].push_back(idx);
+}
+
+/* the block of the level sums its children */
+inline void GLMipmap::_sum(size_t level, size_t bx, size_t by) {
+    const std::vector<uint32_t>& child = _counts[level - 1 - GLMM_BASE];
+    size_t ccols = _cols(level - 1), crows = _rows(level - 1);
+    uint32_t sum = 0;
+    for (size_t cy = by * 2; cy < std::min(by * 2 + 2, crows); cy++)
+        for (size_t cx = bx * 2; cx < std::min(bx * 2 + 2, ccols); cx++) sum += child[cy * ccols + cx];
+    _counts[level - GLMM_BASE][by * _cols(level) + bx] = sum;
+}
+
+/* the words from begin to end of row y, the base blocks take the difference of
+ * the cells that changed, and the tracked blocks of the changed words are marked
+ */
+inline void GLMipmap::_compare(const GLMap& map, size_t y, size_t begin, size_t end) {
+    std::vector<uint32_t>& base = _counts[0];
+    size_t row = (y >> GLMM_BASE) * _cols(GLMM_BASE), trow = (y >> _track) * _cols(_track);
+    size_t left = begin * GLB_WORDBITS;
+    _pack(map[y] + left, std::min(end * GLB_WORDBITS, _width) - left, &_row[begin]);
+    uint64_t* dst = &_cells[y * _words];
+    for (size_t w = begin; w < end; w++) {  //most words are the same as before
+        uint64_t before = dst[w], after = _row[w];
+        if (before == after) continue;
+        size_t x = w * GLB_WORDBITS;
+        uint64_t nb = _nibbles(before), na = _nibbles(after);
+        for (uint64_t diff = before ^ after; diff;) {   //only the base blocks with changed cells
+            size_t bit = ctz64(diff) & ~size_t(3);
+            base[row + ((x + bit) >> GLMM_BASE)] += uint32_t(long((na >> bit) & 0xF) - long((nb >> bit) & 0xF));
+            diff &= ~(uint64_t(0xF) << bit);
+        }
+        size_t stop = std::min(x + GLB_WORDBITS, _width);
+        for (size_t i = x; i < stop; i += size_t(1) << _track) _mark(_track, trow + (i >> _track));
+        dst[w] = after;
+    }
+}
+
+/* the dirty tiles are compared row by row over the runs of adjacent ones, like
+ * the map computes them, then the tracked blocks are counted again inside from the
+ * base blocks, and every dirty block makes its parent sum its four children again,
+ * one level after another, the map is clean afterwards
+ */
+inline void GLMipmap::update(GLMap& map) {
+    _version++;
+    bool whole = !map.tiles() || map.width() != _width || map.height() != _height;
+    if (map.width() != _width || map.height() != _height) _reset(map.width(), map.height());
+
+    if (whole) {
+        for (size_t y = 0; y < _height; y++) _compare(map, y, 0, _words);
+    } else {
+        const std::vector<char>& tiles = map.dirty();
+        size_t tw = (_width + GLM_TILESIZE - 1) / GLM_TILESIZE, th = (_height + GLM_TILESIZE - 1) / GLM_TILESIZE;
+        size_t span = GLM_TILESIZE / GLB_WORDBITS;
+        for (size_t ty = 0; ty < th; ty++) {
+            const char* dirty = &tiles[ty * tw];
+            if (std::find(dirty, dirty + tw, true) == dirty + tw) continue;
+            for (size_t y = ty * GLM_TILESIZE; y < std::min((ty + 1) * GLM_TILESIZE, _height); y++) {
+                for (size_t begin = 0, end; begin < tw; begin = end) {
+                    if (!dirty[begin]) { end = begin + 1; continue; }
+                    for (end = begin; end < tw && dirty[end]; end++);
+                    _compare(map, y, begin * span, std::min(end * span, _words));
+                }
+            }
+        }
+    }
+    map.clean();
+
+    size_t tcols = _cols(_track);
+    for (size_t idx : _dirty[_track - GLMM_BASE]) {
+        size_t tx = idx % tcols, ty = idx / tcols;
+        for (size_t k = GLMM_BASE + 1; k <= _track; k++) {
+            size_t shift = _track - k;
+            for (size_t by = ty << shift; by < std::min((ty + 1) << shift, _rows(k)); by++)
+                for (size_t bx = tx << shift; bx < std::min((tx + 1) << shift, _cols(k)); bx++) _sum(k, bx, by);
+        }
+    }
+
+    for (size_t k = _track; k <= _top; k++) {
+        std::vector<size_t>& dirty = _dirty[k - GLMM_BASE];
+        size_t ccols = _cols(k), pcols = _cols(k + 1);
+        for (size_t idx : dirty) {
+            if (k == _top) break;
+            size_t px = (idx % ccols) / 2, py = (idx / ccols) / 2;
+            if (_stamps[k + 1 - GLMM_BASE][py * pcols + px] == _version) continue;  //a sibling already summed the parent
+            _sum(k + 1, px, py);
+            _mark(k + 1, py * pcols + px);
+        }
+        dirty.clear();
+    }
+}
+
+/* from a mipmap of the same map, a copy of another size, or older than the last
+ * whole count of the mipmap, takes all of it, the copy has no stamps and is not updated
+ */
+inline void GLMipmap::copy(const GLMipmap& from) {
+    if (!from._width) {
+        clear();
+    } else if (from._width != _width || from._height != _height || _version < from._since) {
+        _width = from._width, _height = from._height, _top = from._top;
+        _track = from._track, _words = from._words;
+        _cells = from._cells;
+        _counts = from._counts;
+    } else if (_version != from._version) {
+        _copy(from, _top, 0, 0);
+    }
+    _version = from._version;
+}
+
+/* the block of the level if changed since the copy, down to the tracked blocks,
+ * which take all their counts and their rows of cells
+ */
+inline void GLMipmap::_copy(const GLMipmap& from, size_t level, size_t bx, size_t by) {
+    size_t idx = by * _cols(level) + bx;
+    if (from._stamps[level - GLMM_BASE][idx] <= _version) return;
+    if (level > _track) {
+        _counts[level - GLMM_BASE][idx] = from._counts[level - GLMM_BASE][idx];
+        for (size_t cy = by * 2; cy < std::min(by * 2 + 2, _rows(level - 1)); cy++)
+            for (size_t cx = bx * 2; cx < std::min(bx * 2 + 2, _cols(level - 1)); cx++) _copy(from, level - 1, cx, cy);
+        return;
+    }
+    for (size_t k = GLMM_BASE; k <= _track; k++) {
+        size_t shift = _track - k, cols = _cols(k);
+        size_t left = bx << shift, right = std::min((bx + 1) << shift, cols);
+        for (size_t y = by << shift; y < std::min((by + 1) << shift, _rows(k)); y++)
+            memcpy(&_counts[k - GLMM_BASE][y * cols + left], &from._counts[k - GLMM_BASE][y * cols + left], sizeof(uint32_t) * (right - left));
+    }
+    size_t side = size_t(1) << _track;
+    size_t begin = bx * side / GLB_WORDBITS, end = std::min((bx * side + side + GLB_WORDBITS - 1) / GLB_WORDBITS, _words);
+    for (size_t y = by * side; y < std::min(by * side + side, _height); y++)
+        memcpy(&_cells[y * _words + begin], &from._cells[y * _words + begin], sizeof(uint64_t) * (end - begin));
+}
+
+/* of the block (bx, by) of the level, any level above the top one has a single block */
+inline uint32_t GLMipmap::count(size_t level, size_t bx, size_t by) const {
+    if (level >= GLMM_BASE) {
+        level = std::min(level, _top);
+        return _counts[level - GLMM_BASE][by * _cols(level) + bx];
+    }
+    uint32_t sum = 0;
+    size_t side = size_t(1) << level;
+    for (size_t y = by * side; y < std::min(by * side + side, _height); y++)
+        for (size_t x = bx * side; x < std::min(bx * side + side, _width); x++) sum += (_cells[y * _words + x / GLB_WORDBITS] >> (x % GLB_WORDBITS)) & 1;
+    return sum;
+}
+
+/* cells of the block inside the map */
+inline uint32_t GLMipmap::area(size_t level, size_t bx, size_t by) const {
+    size_t side = size_t(1) << std::min(level, _top);
+    size_t w = std::min(side, _width - bx * side), h = std::min(side, _height - by * side);
+    return uint32_t(w * h);
+}
@@ -0,0 +1,489 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "glmap.h"
+#include "glbitmap.h"
+#include "glhashlife.h"
+#include "glsnapshot.h"
+
+
+#define GLPF_INIT       0   //<width> <height> <scale> [<rule>] <dtype> [<data>]
+#define GLPF_RLE        1   //run length encoded, e.g. x = 3, y = 3 then bo$2bo$3o!
+#define GLPF_CELLS      2   //plaintext, rows of . and O
+#define GLPF_SNAPSHOT   3   //binary snapshot, see glsnapshot.h
+
+#define GLP_TOKENSIZE   64  //the longest token copied out of the file, rules and ratios
+
+
+/* read-only memory mapping of a whole file */
+class GLFile {
+public:
+    GLFile() = default;
+    GLFile(const GLFile&) = delete;
+    GLFile(GLFile&&) = delete;
+    ~GLFile() { close(); }
+
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+    bool open(const char* fname);
+#ifdef _WIN32
+    bool open(const wchar_t* fname);
+#endif
+    void close();
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    bool _map(HANDLE file);
+#endif
+};
+
+#ifdef _WIN32
+inline bool GLFile::open(const char* fname) {
+    return _map(CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+}
+
+inline bool GLFile::open(const wchar_t* fname) {
+    return _map(CreateFileW(fname, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+}
+
+/* the view keeps the mapping alive, so both handles are closed at once */
+inline bool GLFile::_map(HANDLE file) {
+    close();
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size = {};
+    HANDLE mapping = (GetFileSizeEx(file, &size) && size.QuadPart > 0) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    const char* data = (mapping) ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (size.QuadPart > 0 && !data) return false;
+    _data = (data) ? data : "";
+    _size = (data) ? size_t(size.QuadPart) : 0;
+    return true;
+}
+
+inline void GLFile::close() {
+    if (_size > 0) UnmapViewOfFile(_data);
+    _data = nullptr;
+    _size = 0;
+}
+#else
+inline bool GLFile::open(const char* fname) {
+    close();
+    int fd = ::open(fname, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void* data = nullptr;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) madvise(data, size_t(st.st_size), MADV_SEQUENTIAL);
+    }
+    ::close(fd);    //the mapping outlives the descriptor
+    if (data == MAP_FAILED) return false;
+    _data = (data) ? (const char*)data : "";
+    _size = (data) ? size_t(st.st_size) : 0;
+    return true;
+}
+
+inline void GLFile::close() {
+    if (_size > 0) munmap((void*)_data, _size);
+    _data = nullptr;
+    _size = 0;
+}
+#endif
+
+
+/* writes the alive runs of a pattern into a map, cell by cell through set() by default,
+ * bits() writes the len cells from x given by a bit-packed word
+ */
+template<class Map>
+struct GLSink {
+    Map& map;
+
+    void begin() { map.init(); }
+    void run(size_t x, size_t y, size_t len) { for (size_t i = 0; i < len; i++) map.set(x + i, y, true); }
+    void bits(size_t x, size_t y, uint64_t word, size_t len);
+    void end() {}
+};
+
+template<class Map>
+void GLSink<Map>::bits(size_t x, size_t y, uint64_t word, size_t len) {
+    if (len < GLB_WORDBITS) word &= (uint64_t(1) << len) - 1;
+    while (word) {
+        size_t first = ctz64(word), cnt = (~(word >> first)) ? ctz64(~(word >> first)) : GLB_WORDBITS - first;
+        run(x + first, y, cnt);
+        word &= (cnt + first < GLB_WORDBITS) ? ~uint64_t(0) << (cnt + first) : 0;
+    }
+}
+
+template<>
+struct GLSink<GLMap> {
+    GLMap& map;
+
+    void begin() { map.init(); }
+    void run(size_t x, size_t y, size_t len) { memset(&map[y][x], true, sizeof(bool) * len); }
+    void bits(size_t x, size_t y, uint64_t word, size_t len) { unpackWord(word, len, &map[y][x]); }
+    void end() { map.touch(); }
+};
+
+template<>
+struct GLSink<GLBitMap> {
+    GLBitMap& map;
+
+    void begin() { map.init(); }
+    void run(size_t x, size_t y, size_t len) { for (size_t i = 0; i < len; i++) map.set(x + i, y, true); }
+    void bits(size_t x, size_t y, uint64_t word, size_t) { map.row(y)[x / GLB_WORDBITS] = word; }
+    void end() {}
+};
+
+/* HashLife builds its quadtree from a whole window at once, handed over at the end */
+template<>
+struct GLSink<GLHashLife> {
+    GLHashLife& map;
+    std::vector<char> cells = {};
+
+    void begin() { cells.assign(map.width() * map.height(), false); }
+    void run(size_t x, size_t y, size_t len) { memset(&cells[y * map.width() + x], true, len); }
+    void bits(size_t x, size_t y, uint64_t word, size_t len) { unpackWord(word, len, (bool*)&cells[y * map.width() + x]); }
+    void end() { map.init(std::move(cells)); }
+};
+
+
+/* pattern files parsed in place from a memory mapping:
+ * the header is parsed by parse(), giving the size of the map to construct,
+ * then load() writes the cells straight into the map without intermediate containers,
+ * the format is told by the first character, # or x for RLE, ! . O or * for plaintext,
+ * G for snapshots, and a digit for init files
+ */
+class GLPattern {
+public:
+    template<class Char>
+    bool open(const Char* fname) { _body = nullptr; return _file.open(fname); }
+    bool parse() { return _file.data() && _header(); }
+    void close() { _body = nullptr; _file.close(); }
+
+    int format() const { return _format; }
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    int scale() const { return _scale; }    //0 if not given
+    const GLRule& rule() const { return _rule; }
+    size_t gen() const { return _gen; }     //of snapshots, 0 for others
+    bool boundless() const { return _boundless; }
+
+    template<class Map>
+    bool load(Map& map, unsigned seed) const;
+
+private:
+    GLFile _file;
+    const char* _body = nullptr;    //the data after the header
+    int _format = GLPF_INIT;
+    size_t _width = 0, _height = 0;
+    int _scale = 0, _dtype = GLDT_RATIO;
+    GLRule _rule = GLR_CONWAY;
+    size_t _gen = 0;
+    bool _boundless = false;
+
+    const char* _end() const { return _file.data() + _file.size(); }
+    static bool _space(char ch) { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n'; }
+    void _skip(const char*& p) const { while (p < _end() && _space(*p)) p++; }
+    void _line(const char*& p) const;
+    bool _long(const char*& p, long& val) const;
+    size_t _token(const char*& p, char token[GLP_TOKENSIZE + 1], const char* delim = "") const;
+    bool _header();
+    bool _init();
+    bool _rle();
+    bool _cells();
+    bool _snapshot();
+
+    template<class Sink> void _bitmap(Sink& sink) const;
+    template<class Sink> void _coord(Sink& sink) const;
+    template<class Sink> void _rect(Sink& sink) const;
+    template<class Sink> void _runs(Sink& sink) const;
+    template<class Sink> void _rows(Sink& sink) const;
+    template<class Sink> void _words(Sink& sink) const;
+};
+
+/* past the end of the current line */
+inline void GLPattern::_line(const char*& p) const {
+    p = std::find(p, _end(), '\n');
+    if (p < _end()) p++;
+}
+
+inline bool GLPattern::_long(const char*& p, long& val) const {
+    _skip(p);
+    bool neg = p < _end() && *p == '-';
+    const char* digits = p + (neg || (p < _end() && *p == '+'));
+    const char* q = digits;
+    for (val = 0; q < _end() && *q >= '0' && *q <= '9'; q++) val = val * 10 + (*q - '0');
+    if (q == digits) return false;
+    if (neg) val = -val;
+    p = q;
+    return true;
+}
+
+/* the next token up to a space or a delimiter as a C string, empty if too long */
+inline size_t GLPattern::_token(const char*& p, char token[GLP_TOKENSIZE + 1], const char* delim /*""*/) const {
+    _skip(p);
+    size_t len = 0;
+    for (; p < _end() && !_space(*p) && !strchr(delim, *p); p++)
+        if (len < GLP_TOKENSIZE) token[len++] = *p;
+    len = (len < GLP_TOKENSIZE) ? len : 0;
+    token[len] = '\0';
+    return len;
+}
+
+inline bool GLPattern::_header() {
+    const char* p = _file.data();
+    _skip(p);
+    if (p == _end()) return false;
+    switch (*p) {
+    case '#': case 'x': _format = GLPF_RLE; return _rle();
+    case '!': case '.': case 'O': case '*': _format = GLPF_CELLS; return _cells();
+    case 'G': _format = GLPF_SNAPSHOT; return _snapshot();
+    default: _format = GLPF_INIT; return _init();
+    }
+}
+
+inline bool GLPattern::_init() {
+    const char* p = _file.data();
+    long width, height, scale, dtype;
+    char token[GLP_TOKENSIZE + 1];
+    if (!_long(p, width) || !_long(p, height) || !_long(p, scale)) return false;
+
+    const char* type = p;   //an optional rule before the data type
+    if (_token(p, token) && parseRule(token, _rule)) type = p;
+    if (!_long(type, dtype) || width <= 0 || height <= 0) return false;
+
+    _width = size_t(width);
+    _height = size_t(height);
+    _scale = int(scale);
+    _dtype = int(dtype);
+    _body = type;
+    return _dtype >= GLDT_RATIO && _dtype <= GLDT_RECT;
+}
+
+/* comment lines, then x = <width>, y = <height>[, rule = <rule>] */
+inline bool GLPattern::_rle() {
+    const char* p = _file.data();
+    for (_skip(p); p < _end() && *p == '#'; _skip(p)) _line(p);
+
+    long width = 0, height = 0;
+    char token[GLP_TOKENSIZE + 1];
+    while (p < _end() && *p != '\n') {
+        if (!_token(p, token, "=,")) return false;
+        std::string key = token;
+        _skip(p);
+        if (p == _end() || *p++ != '=') return false;
+        if (key == "x" && !_long(p, width)) return false;
+        if (key == "y" && !_long(p, height)) return false;
+        if (key == "rule" && !(_token(p, token, ",:") && parseRule(token, _rule))) return false;
+        if (key == "rule") p = std::find(p, _end(), '\n');    //the rule ends the line, maybe with a topology
+        while (p < _end() && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p < _end() && *p == ',') p++;
+    }
+    if (width <= 0 || height <= 0) return false;
+
+    _width = size_t(width);
+    _height = size_t(height);
+    _body = p;
+    return true;
+}
+
+/* comment lines, then one row per line, the size is the extent of the rows */
+inline bool GLPattern::_cells() {
+    const char* p = _file.data();
+    while (p < _end() && *p == '!') _line(p);
+    _body = p;
+
+    size_t width = 0, height = 0, rows = 0;
+    for (; p < _end(); _line(p)) {
+        if (*p == '!') continue;
+        size_t len = size_t(std::find(p, _end(), '\n') - p);
+        len -= (len > 0 && p[len - 1] == '\r');
+        rows++;
+        if (len > 0) width = std::max(width, len), height = rows;   //trailing empty lines do not count
+    }
+    _width = width;
+    _height = height;
+    return width > 0 && height > 0;
+}
+
+/* the fixed size header of GLS_HEADSIZE bytes */
+inline bool GLPattern::_snapshot() {
+    const char* p = _file.data();
+    if (_file.size() < GLS_HEADSIZE || memcmp(p, GLS_MAGIC, GLS_MAGICSIZE)) return false;
+    auto get = [&p](size_t bytes) {
+        uint64_t val = 0;
+        for (size_t i = 0; i < bytes; i++) val |= uint64_t((unsigned char)*p++) << (8 * i);
+        return val;
+    };
+
+    p += GLS_MAGICSIZE;
+    uint64_t width = get(8), height = get(8), gen = get(8);
+    uint64_t birth = get(2), survive = get(2), flags = get(4);
+    uint64_t limit = uint64_t(~size_t(0)) / GLB_WORDBITS;
+    if (width == 0 || height == 0 || width > limit || height > limit) return false;
+    if ((birth | survive) >> (GLR_MAXCNT + 1)) return false;
+
+    _width = size_t(width);
+    _height = size_t(height);
+    _gen = size_t(gen);
+    _rule = { uint16_t(birth), uint16_t(survive) };
+    _boundless = flags & GLS_BOUNDLESS;
+    _body = p;
+    return true;
+}
+
+template<class Map>
+bool GLPattern::load(Map& map, unsigned seed) const {
+    if (!_body || map.width() != _width || map.height() != _height) return false;
+    if (_format == GLPF_INIT && _dtype == GLDT_RATIO) {
+        const char* p = _body;
+        char token[GLP_TOKENSIZE + 1];
+        map.init((_token(p, token)) ? std::strtof(token, nullptr) : 0.0f, seed);
+        return true;
+    }
+
+    GLSink<Map> sink{ map };
+    sink.begin();
+    switch ((_format == GLPF_INIT) ? _dtype : -_format) {
+    case GLDT_BITMAP: _bitmap(sink); break;
+    case GLDT_COORD: _coord(sink); break;
+    case GLDT_RECT: _rect(sink); break;
+    case -GLPF_RLE: _runs(sink); break;
+    case -GLPF_CELLS: _rows(sink); break;
+    case -GLPF_SNAPSHOT: _words(sink); break;
+    }
+    sink.end();
+    map.gen(_gen);
+    return true;
+}
+
+/* 0 1 1 0 ..., row by row until a value other than 0 and 1 */
+template<class Sink>
+void GLPattern::_bitmap(Sink& sink) const {
+    const char* p = _body;
+    long cell;
+    for (size_t i = 0; i < _width * _height && _long(p, cell) && (cell == 0 || cell == 1); i++)
+        if (cell) sink.run(i % _width, i / _width, 1);
+}
+
+/* x y x y ..., the cells outside of the map are ignored */
+template<class Sink>
+void GLPattern::_coord(Sink& sink) const {
+    const char* p = _body;
+    long x, y;
+    while (_long(p, x) && _long(p, y))
+        if (x >= 0 && y >= 0 && size_t(x) < _width && size_t(y) < _height) sink.run(x, y, 1);
+}
+
+/* left top right bottom ..., clipped to the map */
+template<class Sink>
+void GLPattern::_rect(Sink& sink) const {
+    const char* p = _body;
+    GLRect rc;
+    while (_long(p, rc.left) && _long(p, rc.top) && _long(p, rc.right) && _long(p, rc.bottom)) {
+        long left = std::max(rc.left, 0L), right = std::min(rc.right, long(_width));
+        long top = std::max(rc.top, 0L), bottom = std::min(rc.bottom, long(_height));
+        for (long row = top; left < right && row < bottom; row++) sink.run(left, row, right - left);
+    }
+}
+
+/* <n>b dead, <n>o (or any other letter) alive, <n>$ next rows, ! the end */
+template<class Sink>
+void GLPattern::_runs(Sink& sink) const {
+    size_t x = 0, y = 0, n = 0;
+    for (const char* p = _body; p < _end() && *p != '!' && y < _height; p++) {
+        char ch = *p;
+        if (ch >= '0' && ch <= '9') {
+            n = n * 10 + (ch - '0');
+            continue;
+        }
+        size_t cnt = (n) ? n : 1;
+        n = 0;
+        if (ch == '$') {
+            x = 0;
+            y += cnt;
+        } else if (ch == '#') {
+            _line(p);
+            p--;
+        } else if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')) {
+            if (ch != 'b' && x < _width) sink.run(x, y, std::min(cnt, _width - x));
+            x += cnt;
+        }
+    }
+}
+
+/* . dead, O or * alive, lines starting with ! are comments */
+template<class Sink>
+void GLPattern::_rows(Sink& sink) const {
+    size_t y = 0;
+    for (const char* p = _body; p < _end() && y < _height; _line(p)) {
+        if (*p == '!') continue;
+        const char* eol = std::find(p, _end(), '\n');
+        for (const char* q = p; q < eol;) {
+            if (*q != 'O' && *q != '*') { q++; continue; }
+            const char* run = q;
+            while (q < eol && (*q == 'O' || *q == '*')) q++;
+            sink.run(size_t(run - p), y, size_t(q - run));
+        }
+        y++;
+    }
+}
+
+/* blocks of zero words and literal words, a truncated file leaves the rest dead */
+template<class Sink>
+void GLPattern::_words(Sink& sink) const {
+    const char* p = _body;
+    auto varint = [this, &p](uint64_t& val) {
+        val = 0;
+        for (unsigned shift = 0; p < _end() && shift < 64; shift += 7) {
+            val |= uint64_t(*p & 0x7F) << shift;
+            if (!(*p++ & 0x80)) return true;
+        }
+        return false;
+    };
+
+    size_t nwords = (_width + GLB_WORDBITS - 1) / GLB_WORDBITS, total = nwords * _height;
+    uint64_t idx = 0, zeros, lits;
+    while (idx < total && varint(zeros) && varint(lits)) {
+        if (zeros > total - idx) break;
+        idx += zeros;
+        lits = std::min<uint64_t>({ lits, total - idx, uint64_t(_end() - p) / 8 });
+        for (uint64_t i = 0; i < lits; i++, idx++, p += 8) {
+            uint64_t word;
+            memcpy(&word, p, 8);
+            size_t x = size_t(idx % nwords) * GLB_WORDBITS, y = size_t(idx / nwords);
+            size_t len = std::min<size_t>(GLB_WORDBITS, _width - x);
+            if (len < GLB_WORDBITS) word &= (uint64_t(1) << len) - 1;
+            sink.bits(x, y, word, len);
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/* persistent thread pool:
+ * the workers are created once and sleep between rounds, each run() wakes them to
+ * share the tasks [0, ntasks) with the calling thread and returns when all are done
+ */
+class GLPool {
+public:
+    explicit GLPool(size_t nthreads);
+    GLPool(const GLPool&) = delete;
+    GLPool(GLPool&&) = delete;
+    ~GLPool();
+
+    size_t size() const { return _threads.size() + 1; }
+    void run(size_t ntasks, const std::function<void(size_t)>& task);
+
+private:
+    std::vector<std::thread> _threads;
+    std::mutex _mtx;
+    std::condition_variable _cvstart, _cvdone;
+    const std::function<void(size_t)>* _task = nullptr;
+    size_t _ntasks = 0, _running = 0, _round = 0;
+    std::atomic<size_t> _cursor{ 0 };
+    bool _quit = false;
+
+    void _drain() { for (size_t i; (i = _cursor.fetch_add(1)) < _ntasks;) (*_task)(i); }
+    void _work();
+};
+
+inline GLPool::GLPool(size_t nthreads) {
+    for (size_t i = 1; i < nthreads; i++) _threads.emplace_back(&GLPool::_work, this);
+}
+
+inline GLPool::~GLPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _quit = true;
+    }
+    _cvstart.notify_all();
+    for (auto& th : _threads) th.join();
+}
+
+inline void GLPool::run(size_t ntasks, const std::function<void(size_t)>& task) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _task = &task;
+        _ntasks = ntasks;
+        _cursor = 0;
+        _running = _threads.size();
+        _round++;
+    }
+    _cvstart.notify_all();
+    _drain();
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    _cvdone.wait(lock, [this] { return _running == 0; });
+}
+
+inline void GLPool::_work() {
+    size_t round = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cvstart.wait(lock, [this, round] { return _quit || _round != round; });
+            if (_quit) return;
+            round = _round;
+        }
+        _drain();
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (--_running == 0) _cvdone.notify_one();
+        }
+    }
+}
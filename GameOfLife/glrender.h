@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "glmap.h"
+#include "glmipmap.h"
+
+
+#define GLC_CHUNK       64      //cells compared at once with the cached cells
+#define GLC_MINSHADE    64      //of 256, the faintest shade of a block with alive cells
+
+
+/* colours as 0x00RRGGBB, the layout of 32-bit DIB pixels on Windows */
+struct GLPalette {
+    uint32_t blank, cell, edge, bounds;
+};
+
+inline bool operator==(const GLPalette& lhs, const GLPalette& rhs) {
+    return lhs.blank == rhs.blank && lhs.cell == rhs.cell && lhs.edge == rhs.edge && lhs.bounds == rhs.bounds;
+}
+
+/* persistent 32-bit pixel buffer of a view of a map, rows top-down:
+ * the map is drawn as in the window, surrounded by a one-cell edge, with its
+ * top-left corner at (left, top) and scale pixels per cell, only the cells inside
+ * the canvas are visited, and they are cached so that while the view stays the
+ * same, only the cells that changed since the last render are painted again,
+ * rows(y, x) gives the cells of row y of the map from column x on as 0/1 bytes,
+ * and is only asked for the cells of visible(), so a view of the map is enough,
+ * zoomed out, a pixel covers a block of 2^shrink x 2^shrink cells and is shaded
+ * by the density of the block taken from a mipmap, so every pixel is visited
+ * instead of every cell
+ */
+class GLCanvas {
+public:
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    const uint32_t* pixels() const { return _pixels.data(); }
+    uint32_t operator()(size_t x, size_t y) const { return _pixels[y * _width + x]; }
+    size_t memory() const { return _pixels.size() * sizeof(uint32_t) + _cells.size(); }
+
+    void resize(size_t width, size_t height);
+    void invalidate() { _full = true; }     //the next render paints everything
+    GLRect visible(size_t mapw, size_t maph, long left, long top, int scale) const;
+    template<class Rows>
+    void render(size_t mapw, size_t maph, Rows rows, long left, long top, int scale, const GLPalette& palette, const GLRect* bbox = nullptr);
+    void render(const GLMipmap& mipmap, long left, long top, int shrink, const GLPalette& palette, const GLRect* bbox = nullptr);
+    bool save(std::ostream& out) const;
+
+private:
+    struct View {
+        size_t mapw, maph;
+        long left, top;
+        int scale, shrink;
+        GLPalette palette;
+
+        bool operator==(const View& rhs) const {
+            return mapw == rhs.mapw && maph == rhs.maph && left == rhs.left && top == rhs.top && scale == rhs.scale && shrink == rhs.shrink && palette == rhs.palette;
+        }
+    };
+
+    size_t _width = 0, _height = 0;
+    std::vector<uint32_t> _pixels;
+    bool _full = true;
+    View _view = {};
+    size_t _x0 = 0, _x1 = 0, _y0 = 0, _y1 = 0;  //the visible cells of the view
+    std::vector<char> _cells;   //cached visible cells, row by row
+    bool _framed = false;       //a bounding box is drawn
+    GLRect _bbox = {};
+
+    static long _floordiv(long a, long b) { return (a >= 0) ? a / b : -((-a + b - 1) / b); }
+    long _pos(size_t cell, long origin) const { return (long(cell >> _view.shrink) + 1) * _view.scale + origin; }
+    long _end(size_t cell, long origin) const { return _pos(cell + (size_t(1) << _view.shrink) - 1, origin); }  //after the cells before
+    void _background(long right, long bottom);
+    void _fill(long left, long top, long right, long bottom, uint32_t color);
+    void _cell(size_t x, size_t y, bool alive);
+    void _frame(const GLRect& bbox, uint32_t color);
+    void _repaint(size_t x, size_t y);
+};
+
+inline void GLCanvas::resize(size_t width, size_t height) {
+    if (width == _width && height == _height) return;
+    _width = width;
+    _height = height;
+    _pixels.assign(width * height, 0);
+    _full = true;
+}
+
+/* clipped to the canvas */
+inline void GLCanvas::_fill(long left, long top, long right, long bottom, uint32_t color) {
+    left = std::max(left, 0L), top = std::max(top, 0L);
+    right = std::min(right, long(_width)), bottom = std::min(bottom, long(_height));
+    for (long y = top; y < bottom && left < right; y++) std::fill(&_pixels[y * _width + left], &_pixels[y * _width + right], color);
+}
+
+inline void GLCanvas::_cell(size_t x, size_t y, bool alive) {
+    long px = _pos(x, _view.left), py = _pos(y, _view.top);
+    _fill(px, py, px + _view.scale, py + _view.scale, (alive) ? _view.palette.cell : _view.palette.blank);
+}
+
+/* one pixel inside the cells of the box, as FrameRect() */
+inline void GLCanvas::_frame(const GLRect& bbox, uint32_t color) {
+    long l = _pos(bbox.left, _view.left), t = _pos(bbox.top, _view.top);
+    long r = _end(bbox.right, _view.left), b = _end(bbox.bottom, _view.top);
+    _fill(l, t, r, t + 1, color);
+    _fill(l, b - 1, r, b, color);
+    _fill(l, t, l + 1, b, color);
+    _fill(r - 1, t, r, b, color);
+}
+
+/* the edge around the content, of right x bottom pixels from (left, top) */
+inline void GLCanvas::_background(long right, long bottom) {
+    long left = _view.left, top = _view.top, scale = _view.scale;
+    right += left, bottom += top;
+    _fill(0, 0, long(_width), long(_height), _view.palette.blank);
+    _fill(left, top, right, bottom, _view.palette.edge);
+    _fill(left + scale, top + scale, right - scale, bottom - scale, _view.palette.blank);
+}
+
+/* a cached cell, if visible */
+inline void GLCanvas::_repaint(size_t x, size_t y) {
+    if (x >= _x0 && x < _x1 && y >= _y0 && y < _y1) _cell(x, y, _cells[(y - _y0) * (_x1 - _x0) + x - _x0]);
+}
+
+/* the cells of the map drawn as in render() with a pixel inside the canvas */
+inline GLRect GLCanvas::visible(size_t mapw, size_t maph, long left, long top, int scale) const {
+    GLRect rect;
+    rect.left = std::min(std::max(_floordiv(-left, scale) - 1, 0L), long(mapw));
+    rect.right = std::min(std::max(_floordiv(long(_width) - 1 - left, scale), 0L), long(mapw));
+    rect.top = std::min(std::max(_floordiv(-top, scale) - 1, 0L), long(maph));
+    rect.bottom = std::min(std::max(_floordiv(long(_height) - 1 - top, scale), 0L), long(maph));
+    rect.right = std::max(rect.left, rect.right), rect.bottom = std::max(rect.top, rect.bottom);
+    return rect;
+}
+
+/* the cells of the last box are painted again to erase it, which also covers a
+ * box made of blank pixels when nothing changed
+ */
+template<class Rows>
+void GLCanvas::render(size_t mapw, size_t maph, Rows rows, long left, long top, int scale, const GLPalette& palette, const GLRect* bbox /*nullptr*/) {
+    View view = { mapw, maph, left, top, scale, 0, palette };
+    bool full = _full || !(view == _view);
+    _view = view;
+    _full = false;
+
+    if (full) {
+        GLRect rect = visible(mapw, maph, left, top, scale);
+        _x0 = size_t(rect.left), _x1 = size_t(rect.right), _y0 = size_t(rect.top), _y1 = size_t(rect.bottom);
+        _cells.assign((_x1 - _x0) * (_y1 - _y0), false);
+
+        _background((long(mapw) + 2) * scale, (long(maph) + 2) * scale);
+        _framed = false;
+    } else if (_framed) {
+        for (size_t x = size_t(_bbox.left); x < size_t(_bbox.right); x++) _repaint(x, size_t(_bbox.top)), _repaint(x, size_t(_bbox.bottom) - 1);
+        for (size_t y = size_t(_bbox.top); y < size_t(_bbox.bottom); y++) _repaint(size_t(_bbox.left), y), _repaint(size_t(_bbox.right) - 1, y);
+    }
+
+    size_t span = _x1 - _x0;
+    for (size_t y = _y0; y < _y1 && span; y++) {
+        const char* src = (const char*)rows(y, _x0);
+        char* cache = &_cells[(y - _y0) * span];
+        for (size_t x = 0; x < span; x += GLC_CHUNK) {  //most chunks are the same as before
+            size_t len = std::min<size_t>(GLC_CHUNK, span - x);
+            if (!memcmp(src + x, cache + x, len)) continue;
+            for (size_t i = x; i < x + len; i++) {
+                if (src[i] == cache[i]) continue;
+                cache[i] = src[i];
+                _cell(_x0 + i, y, src[i]);
+            }
+        }
+    }
+
+    _framed = bbox != nullptr;
+    if (_framed) _bbox = *bbox, _frame(_bbox, palette.bounds);
+}
+
+/* always painted in full, the cost only depends on the pixels of the canvas,
+ * the blocks are shaded linearly from blank to cell by their density
+ */
+inline void GLCanvas::render(const GLMipmap& mipmap, long left, long top, int shrink, const GLPalette& palette, const GLRect* bbox /*nullptr*/) {
+    size_t mapw = mipmap.width(), maph = mipmap.height(), side = size_t(1) << shrink;
+    size_t cols = (mapw + side - 1) >> shrink, rows = (maph + side - 1) >> shrink;
+    _view = { mapw, maph, left, top, 1, shrink, palette };
+    _full = true;   //the cached cells are not kept up to date
+    _framed = false;
+    _background(long(cols) + 2, long(rows) + 2);
+
+    auto channel = [](uint32_t from, uint32_t to, uint32_t shade, int shift) {
+        long a = (from >> shift) & 0xFF, b = (to >> shift) & 0xFF;
+        return uint32_t(a + (b - a) * long(shade) / 256) << shift;
+    };
+    long x0 = std::max(left + 1, 0L), x1 = std::min(left + 1 + long(cols), long(_width));
+    long y0 = std::max(top + 1, 0L), y1 = std::min(top + 1 + long(rows), long(_height));
+    for (long y = y0; y < y1; y++) {
+        size_t by = size_t(y - top - 1);
+        uint32_t* line = &_pixels[y * _width];
+        for (long x = x0; x < x1; x++) {
+            size_t bx = size_t(x - left - 1);
+            uint32_t count = mipmap.count(shrink, bx, by);
+            if (!count) continue;
+            uint32_t shade = std::max<uint32_t>(uint32_t(uint64_t(count) * 256 / mipmap.area(shrink, bx, by)), GLC_MINSHADE);
+            line[x] = channel(palette.blank, palette.cell, shade, 16) | channel(palette.blank, palette.cell, shade, 8) | channel(palette.blank, palette.cell, shade, 0);
+        }
+    }
+
+    if (bbox) _frame(*bbox, palette.bounds);
+}
+
+/* binary PPM */
+inline bool GLCanvas::save(std::ostream& out) const {
+    out << "P6\n" << _width << ' ' << _height << "\n255\n";
+    std::vector<char> line(_width * 3);
+    for (size_t y = 0; y < _height; y++) {
+        for (size_t x = 0; x < _width; x++) {
+            uint32_t pixel = _pixels[y * _width + x];
+            line[x * 3] = char((pixel >> 16) & 0xFF);
+            line[x * 3 + 1] = char((pixel >> 8) & 0xFF);
+            line[x * 3 + 2] = char(pixel & 0xFF);
+        }
+        out.write(line.data(), line.size());
+    }
+    return bool(out.flush());
+}
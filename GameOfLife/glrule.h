@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+
+#define GL_BIRTHCNT     3
+#define GL_ALIVECNT     2
+
+#define GLR_MAXCNT      8
+#define GLR_CONWAY      GLRule{ 1 << GL_BIRTHCNT, (1 << GL_ALIVECNT) | (1 << GL_BIRTHCNT) }
+
+
+/* outer-totalistic rule:
+ * bit n of birth is set if a dead cell with n alive neighbours is born,
+ * bit n of survive is set if an alive cell with n alive neighbours survives
+ */
+struct GLRule {
+    uint16_t birth, survive;
+
+    bool operator()(bool alive, unsigned cnt) const { return (((alive) ? survive : birth) >> cnt) & 1; }
+    bool conway() const { return birth == GLR_CONWAY.birth && survive == GLR_CONWAY.survive; }
+};
+
+inline bool operator==(const GLRule& lhs, const GLRule& rhs) { return lhs.birth == rhs.birth && lhs.survive == rhs.survive; }
+inline bool operator!=(const GLRule& lhs, const GLRule& rhs) { return !(lhs == rhs); }
+
+/* B/S notation, e.g. B3/S23 or b36/s23, either part may come first and may be empty,
+ * or the older S/B notation of digits only, e.g. 23/3
+ */
+template<class Char>
+bool parseRule(const Char* str, GLRule& rule) {
+    GLRule res = {};
+    bool parts[2] = {};     //B and S seen
+    bool digits = *str == '/' || (*str >= '0' && *str <= '9');
+    for (const Char* p = str; *p;) {
+        int part = (digits) ? !parts[1] : (*p == 'B' || *p == 'b') ? 0 : (*p == 'S' || *p == 's') ? 1 : -1;
+        if (part < 0 || parts[part]) return false;
+        parts[part] = true;
+        uint16_t& mask = (part) ? res.survive : res.birth;
+        for (p += !digits; *p >= '0' && *p <= '0' + GLR_MAXCNT; p++) mask |= 1 << (*p - '0');
+        if (*p == '/' && (p[1] || (digits && part))) parts[0] |= !*++p && digits;  //an empty B at the end of S/B
+        else if (*p) return false;
+    }
+    if (!parts[0] || !parts[1]) return false;
+    rule = res;
+    return true;
+}
+
+inline std::string ruleString(const GLRule& rule) {
+    std::string str = "B";
+    for (unsigned n = 0; n <= GLR_MAXCNT; n++) if ((rule.birth >> n) & 1) str += char('0' + n);
+    str += "/S";
+    for (unsigned n = 0; n <= GLR_MAXCNT; n++) if ((rule.survive >> n) & 1) str += char('0' + n);
+    return str;
+}
@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "glrule.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define GLK_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GLK_TARGET(isa) __attribute__((target(isa)))
+#else
+#define GLK_TARGET(isa)
+#endif
+
+
+#define GLK_SCALAR      0
+#define GLK_SSE2        1
+#define GLK_AVX2        2
+
+#define GLK_CHUNKBITS   6
+
+
+/* row kernels for the byte-per-cell map:
+ * compute dst[x] for x in [begin, end) from three rows of 0/1 bytes,
+ * the caller guarantees that [begin - 1, end] is readable in every row,
+ * and if changed is given, the chunks of 64 cells where any cell changed are
+ * flagged as changed[x / 64] (conservatively for vectors across two chunks),
+ * every kernel has a Conway instantiation ignoring the rule and a generic one
+ * looking the counts up in the birth and survival masks of the rule
+ */
+typedef void (*GLRowKernel)(bool* dst, const bool* up, const bool* mid, const bool* down, size_t begin, size_t end, char* changed, const GLRule& rule);
+
+template<bool Any>
+inline void stepRowScalar(bool* dst, const bool* up, const bool* mid, const bool* down, size_t begin, size_t end, char* changed, const GLRule& rule) {
+    for (size_t x = begin; x < end; x++) {
+        unsigned cnt = up[x - 1] + up[x] + up[x + 1] + mid[x - 1] + mid[x + 1] + down[x - 1] + down[x] + down[x + 1];
+        dst[x] = (Any) ? rule(mid[x], cnt) : (cnt == GL_BIRTHCNT) + (cnt == GL_ALIVECNT) * mid[x];
+        if (changed) changed[x >> GLK_CHUNKBITS] |= dst[x] != mid[x];
+    }
+}
+
+#ifdef GLK_X86
+/* SSE2 has no byte shuffle, so the generic rule compares the counts with each
+ * count in its masks, listed once per row as counts[0, size)
+ */
+struct GLCounts {
+    __m128i counts[GLR_MAXCNT + 1];
+    unsigned size = 0;
+
+    GLK_TARGET("sse2") explicit GLCounts(uint16_t mask) {
+        for (unsigned n = 0; n <= GLR_MAXCNT; n++)
+            if ((mask >> n) & 1) counts[size++] = _mm_set1_epi8(char(n));
+    }
+    GLK_TARGET("sse2") __m128i operator()(__m128i cnt) const {
+        __m128i res = _mm_setzero_si128();
+        for (unsigned i = 0; i < size; i++) res = _mm_or_si128(res, _mm_cmpeq_epi8(cnt, counts[i]));
+        return res;
+    }
+};
+
+template<bool Any>
+GLK_TARGET("sse2")
+inline void stepRowSSE2(bool* dst, const bool* up, const bool* mid, const bool* down, size_t begin, size_t end, char* changed, const GLRule& rule) {
+    const __m128i one = _mm_set1_epi8(1), birth = _mm_set1_epi8(GL_BIRTHCNT), alive = _mm_set1_epi8(GL_ALIVECNT);
+    const GLCounts born((Any) ? rule.birth : 0), kept((Any) ? rule.survive : 0);
+    size_t x = begin;
+    for (; x + 16 <= end; x += 16) {    //16 cells per instruction
+        __m128i cnt = _mm_loadu_si128((const __m128i*)(up + x - 1));
+        cnt = _mm_add_epi8(cnt, _mm_loadu_si128((const __m128i*)(up + x)));
+        cnt = _mm_add_epi8(cnt, _mm_loadu_si128((const __m128i*)(up + x + 1)));
+        cnt = _mm_add_epi8(cnt, _mm_loadu_si128((const __m128i*)(mid + x - 1)));
+        cnt = _mm_add_epi8(cnt, _mm_loadu_si128((const __m128i*)(mid + x + 1)));
+        cnt = _mm_add_epi8(cnt, _mm_loadu_si128((const __m128i*)(down + x - 1)));
+        cnt = _mm_add_epi8(cnt, _mm_loadu_si128((const __m128i*)(down + x)));
+        cnt = _mm_add_epi8(cnt, _mm_loadu_si128((const __m128i*)(down + x + 1)));
+        __m128i self = _mm_loadu_si128((const __m128i*)(mid + x));
+        __m128i res;
+        if (Any) {  //born or survived, selected by the 0/1 cell itself
+            __m128i b = _mm_and_si128(born(cnt), one), s = _mm_and_si128(kept(cnt), one);
+            res = _mm_xor_si128(b, _mm_and_si128(_mm_xor_si128(b, s), self));
+        } else {
+            res = _mm_or_si128(_mm_cmpeq_epi8(cnt, birth), _mm_and_si128(_mm_cmpeq_epi8(cnt, alive), self));
+            res = _mm_and_si128(res, one);
+        }
+        _mm_storeu_si128((__m128i*)(dst + x), res);
+        if (changed) {  //no branch on the data, it is unpredictable
+            char diff = _mm_movemask_epi8(_mm_cmpeq_epi8(res, self)) != 0xFFFF;
+            changed[x >> GLK_CHUNKBITS] |= diff;
+            changed[(x + 15) >> GLK_CHUNKBITS] |= diff;
+        }
+    }
+    stepRowScalar<Any>(dst, up, mid, down, x, end, changed, rule);
+}
+
+/* a 16-entry table of 0/1 bytes in both lanes, entry n for n alive neighbours */
+GLK_TARGET("avx2")
+inline __m256i tableAVX2(uint16_t mask) {
+    alignas(32) char table[32] = {};
+    for (unsigned n = 0; n <= GLR_MAXCNT; n++) table[n] = table[n + 16] = (mask >> n) & 1;
+    return _mm256_load_si256((const __m256i*)table);
+}
+
+template<bool Any>
+GLK_TARGET("avx2")
+inline void stepRowAVX2(bool* dst, const bool* up, const bool* mid, const bool* down, size_t begin, size_t end, char* changed, const GLRule& rule) {
+    const __m256i one = _mm256_set1_epi8(1), birth = _mm256_set1_epi8(GL_BIRTHCNT), alive = _mm256_set1_epi8(GL_ALIVECNT);
+    const __m256i btable = (Any) ? tableAVX2(rule.birth) : one, stable = (Any) ? tableAVX2(rule.survive) : one;
+    size_t x = begin;
+    for (; x + 32 <= end; x += 32) {    //32 cells per instruction
+        __m256i cnt = _mm256_loadu_si256((const __m256i*)(up + x - 1));
+        cnt = _mm256_add_epi8(cnt, _mm256_loadu_si256((const __m256i*)(up + x)));
+        cnt = _mm256_add_epi8(cnt, _mm256_loadu_si256((const __m256i*)(up + x + 1)));
+        cnt = _mm256_add_epi8(cnt, _mm256_loadu_si256((const __m256i*)(mid + x - 1)));
+        cnt = _mm256_add_epi8(cnt, _mm256_loadu_si256((const __m256i*)(mid + x + 1)));
+        cnt = _mm256_add_epi8(cnt, _mm256_loadu_si256((const __m256i*)(down + x - 1)));
+        cnt = _mm256_add_epi8(cnt, _mm256_loadu_si256((const __m256i*)(down + x)));
+        cnt = _mm256_add_epi8(cnt, _mm256_loadu_si256((const __m256i*)(down + x + 1)));
+        __m256i self = _mm256_loadu_si256((const __m256i*)(mid + x));
+        __m256i res;
+        if (Any) {  //two byte shuffles cost as much as the Conway comparisons
+            __m256i b = _mm256_shuffle_epi8(btable, cnt), s = _mm256_shuffle_epi8(stable, cnt);
+            res = _mm256_xor_si256(b, _mm256_and_si256(_mm256_xor_si256(b, s), self));
+        } else {
+            res = _mm256_or_si256(_mm256_cmpeq_epi8(cnt, birth), _mm256_and_si256(_mm256_cmpeq_epi8(cnt, alive), self));
+            res = _mm256_and_si256(res, one);
+        }
+        _mm256_storeu_si256((__m256i*)(dst + x), res);
+        if (changed) {  //no branch on the data, it is unpredictable
+            char diff = !_mm256_testc_si256(_mm256_cmpeq_epi8(res, self), _mm256_set1_epi8(-1));
+            changed[x >> GLK_CHUNKBITS] |= diff;
+            changed[(x + 31) >> GLK_CHUNKBITS] |= diff;
+        }
+    }
+    stepRowSSE2<Any>(dst, up, mid, down, x, end, changed, rule);
+}
+#endif
+
+/* row counters for the statistics of the byte-per-cell map:
+ * add the alive cells, births and deaths of [begin, end) to counts[0], [1] and [2],
+ * comparing the row of the new generation with the same row of the previous one
+ */
+typedef void (*GLRowCount)(const bool* now, const bool* before, size_t begin, size_t end, size_t counts[3]);
+
+inline void countRowScalar(const bool* now, const bool* before, size_t begin, size_t end, size_t counts[3]) {
+    for (size_t x = begin; x < end; x++) {
+        counts[0] += now[x];
+        counts[1] += now[x] & !before[x];
+        counts[2] += before[x] & !now[x];
+    }
+}
+
+#ifdef GLK_X86
+GLK_TARGET("sse2")
+inline void countRowSSE2(const bool* now, const bool* before, size_t begin, size_t end, size_t counts[3]) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i alive = zero, born = zero, died = zero;
+    size_t x = begin;
+    for (; x + 16 <= end; x += 16) {    //the sums of absolute differences add 8 bytes into a 64-bit lane
+        __m128i a = _mm_loadu_si128((const __m128i*)(now + x)), b = _mm_loadu_si128((const __m128i*)(before + x));
+        alive = _mm_add_epi64(alive, _mm_sad_epu8(a, zero));
+        born = _mm_add_epi64(born, _mm_sad_epu8(_mm_andnot_si128(b, a), zero));
+        died = _mm_add_epi64(died, _mm_sad_epu8(_mm_andnot_si128(a, b), zero));
+    }
+    alignas(16) uint64_t lanes[6];
+    _mm_store_si128((__m128i*)lanes, alive);
+    _mm_store_si128((__m128i*)lanes + 1, born);
+    _mm_store_si128((__m128i*)lanes + 2, died);
+    for (int i = 0; i < 3; i++) counts[i] += size_t(lanes[2 * i] + lanes[2 * i + 1]);
+    countRowScalar(now, before, x, end, counts);
+}
+
+GLK_TARGET("avx2")
+inline void countRowAVX2(const bool* now, const bool* before, size_t begin, size_t end, size_t counts[3]) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i alive = zero, born = zero, died = zero;
+    size_t x = begin;
+    for (; x + 32 <= end; x += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(now + x)), b = _mm256_loadu_si256((const __m256i*)(before + x));
+        alive = _mm256_add_epi64(alive, _mm256_sad_epu8(a, zero));
+        born = _mm256_add_epi64(born, _mm256_sad_epu8(_mm256_andnot_si256(b, a), zero));
+        died = _mm256_add_epi64(died, _mm256_sad_epu8(_mm256_andnot_si256(a, b), zero));
+    }
+    alignas(32) uint64_t lanes[12];
+    _mm256_store_si256((__m256i*)lanes, alive);
+    _mm256_store_si256((__m256i*)lanes + 1, born);
+    _mm256_store_si256((__m256i*)lanes + 2, died);
+    for (int i = 0; i < 3; i++) counts[i] += size_t(lanes[4 * i] + lanes[4 * i + 1] + lanes[4 * i + 2] + lanes[4 * i + 3]);
+    countRowSSE2(now, before, x, end, counts);
+}
+#endif
+
+/* row packers for the byte-per-cell map:
+ * pack the cells [0, width) of a row into ceil(width / 64) words, bit i of word j
+ * is cell 64 * j + i as in GLBitMap, the padding bits of the last word are zero
+ */
+typedef void (*GLRowPack)(const bool* cells, size_t width, uint64_t* words);
+
+inline void packRowScalar(const bool* cells, size_t width, uint64_t* words) {
+    for (size_t x = 0; x < width; x += 64) {
+        uint64_t word = 0;
+        size_t i = 0, len = (width - x < 64) ? width - x : 64;
+        for (; i + 8 <= len; i += 8) {  //gathers bit 0 of the 8 bytes into the top byte
+            uint64_t bytes;
+            memcpy(&bytes, cells + x + i, 8);
+            word |= ((bytes * 0x0102040810204080ULL) >> 56) << i;
+        }
+        for (; i < len; i++) word |= uint64_t(cells[x + i]) << i;
+        *words++ = word;
+    }
+}
+
+#ifdef GLK_X86
+GLK_TARGET("sse2")
+inline void packRowSSE2(const bool* cells, size_t width, uint64_t* words) {
+    size_t x = 0;
+    for (; x + 64 <= width; x += 64) {  //bit 0 of every byte moved to bit 7 for the byte mask
+        uint64_t word = 0;
+        for (size_t i = 0; i < 64; i += 16)
+            word |= uint64_t(unsigned(_mm_movemask_epi8(_mm_slli_epi16(_mm_loadu_si128((const __m128i*)(cells + x + i)), 7)))) << i;
+        *words++ = word;
+    }
+    if (x < width) packRowScalar(cells + x, width - x, words);
+}
+
+GLK_TARGET("avx2")
+inline void packRowAVX2(const bool* cells, size_t width, uint64_t* words) {
+    size_t x = 0;
+    for (; x + 64 <= width; x += 64) {
+        uint64_t low = unsigned(_mm256_movemask_epi8(_mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)(cells + x)), 7)));
+        uint64_t high = unsigned(_mm256_movemask_epi8(_mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)(cells + x + 32)), 7)));
+        *words++ = low | (high << 32);
+    }
+    if (x < width) packRowScalar(cells + x, width - x, words);
+}
+#endif
+
+/* column kernels for the bit-packed map, Conway only:
+ * dst[i] is the next word of row i + 1 of a column of n + 2 words, where west,
+ * center and east hold the rows shifted so that bit j is the west, own and east
+ * neighbour of the cell at bit j, the adders are those of stepWord in glbitmap.h
+ */
+typedef void (*GLColumnKernel)(uint64_t* dst, const uint64_t* west, const uint64_t* center, const uint64_t* east, size_t n);
+
+inline void stepColumnScalar(uint64_t* dst, const uint64_t* west, const uint64_t* center, const uint64_t* east, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint64_t t0 = west[i] ^ center[i] ^ east[i];
+        uint64_t t1 = (west[i] & center[i]) | (east[i] & (west[i] ^ center[i]));
+        uint64_t b0 = west[i + 2] ^ center[i + 2] ^ east[i + 2];
+        uint64_t b1 = (west[i + 2] & center[i + 2]) | (east[i + 2] & (west[i + 2] ^ center[i + 2]));
+        uint64_t m0 = west[i + 1] ^ east[i + 1], m1 = west[i + 1] & east[i + 1];
+        uint64_t x0 = t0 ^ m0 ^ b0, c0 = (t0 & m0) | (b0 & (t0 ^ m0));
+        uint64_t s1 = t1 ^ m1, s2 = b1 ^ c0;
+        uint64_t y1 = (t1 & m1) | (b1 & c0) | (s1 & s2);
+        dst[i] = (s1 ^ s2) & ~y1 & (x0 | center[i + 1]);
+    }
+}
+
+#ifdef GLK_X86
+GLK_TARGET("sse2")
+inline void stepColumnSSE2(uint64_t* dst, const uint64_t* west, const uint64_t* center, const uint64_t* east, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {    //2 rows per instruction
+        __m128i wt = _mm_loadu_si128((const __m128i*)(west + i)), ct = _mm_loadu_si128((const __m128i*)(center + i)), et = _mm_loadu_si128((const __m128i*)(east + i));
+        __m128i wb = _mm_loadu_si128((const __m128i*)(west + i + 2)), cb = _mm_loadu_si128((const __m128i*)(center + i + 2)), eb = _mm_loadu_si128((const __m128i*)(east + i + 2));
+        __m128i wm = _mm_loadu_si128((const __m128i*)(west + i + 1)), cm = _mm_loadu_si128((const __m128i*)(center + i + 1)), em = _mm_loadu_si128((const __m128i*)(east + i + 1));
+        __m128i t0 = _mm_xor_si128(_mm_xor_si128(wt, ct), et);
+        __m128i t1 = _mm_or_si128(_mm_and_si128(wt, ct), _mm_and_si128(et, _mm_xor_si128(wt, ct)));
+        __m128i b0 = _mm_xor_si128(_mm_xor_si128(wb, cb), eb);
+        __m128i b1 = _mm_or_si128(_mm_and_si128(wb, cb), _mm_and_si128(eb, _mm_xor_si128(wb, cb)));
+        __m128i m0 = _mm_xor_si128(wm, em), m1 = _mm_and_si128(wm, em);
+        __m128i x0 = _mm_xor_si128(_mm_xor_si128(t0, m0), b0);
+        __m128i c0 = _mm_or_si128(_mm_and_si128(t0, m0), _mm_and_si128(b0, _mm_xor_si128(t0, m0)));
+        __m128i s1 = _mm_xor_si128(t1, m1), s2 = _mm_xor_si128(b1, c0);
+        __m128i y1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(t1, m1), _mm_and_si128(b1, c0)), _mm_and_si128(s1, s2));
+        __m128i res = _mm_andnot_si128(y1, _mm_and_si128(_mm_xor_si128(s1, s2), _mm_or_si128(x0, cm)));
+        _mm_storeu_si128((__m128i*)(dst + i), res);
+    }
+    stepColumnScalar(dst + i, west + i, center + i, east + i, n - i);
+}
+
+GLK_TARGET("avx2")
+inline void stepColumnAVX2(uint64_t* dst, const uint64_t* west, const uint64_t* center, const uint64_t* east, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {    //4 rows per instruction
+        __m256i wt = _mm256_loadu_si256((const __m256i*)(west + i)), ct = _mm256_loadu_si256((const __m256i*)(center + i)), et = _mm256_loadu_si256((const __m256i*)(east + i));
+        __m256i wb = _mm256_loadu_si256((const __m256i*)(west + i + 2)), cb = _mm256_loadu_si256((const __m256i*)(center + i + 2)), eb = _mm256_loadu_si256((const __m256i*)(east + i + 2));
+        __m256i wm = _mm256_loadu_si256((const __m256i*)(west + i + 1)), cm = _mm256_loadu_si256((const __m256i*)(center + i + 1)), em = _mm256_loadu_si256((const __m256i*)(east + i + 1));
+        __m256i t0 = _mm256_xor_si256(_mm256_xor_si256(wt, ct), et);
+        __m256i t1 = _mm256_or_si256(_mm256_and_si256(wt, ct), _mm256_and_si256(et, _mm256_xor_si256(wt, ct)));
+        __m256i b0 = _mm256_xor_si256(_mm256_xor_si256(wb, cb), eb);
+        __m256i b1 = _mm256_or_si256(_mm256_and_si256(wb, cb), _mm256_and_si256(eb, _mm256_xor_si256(wb, cb)));
+        __m256i m0 = _mm256_xor_si256(wm, em), m1 = _mm256_and_si256(wm, em);
+        __m256i x0 = _mm256_xor_si256(_mm256_xor_si256(t0, m0), b0);
+        __m256i c0 = _mm256_or_si256(_mm256_and_si256(t0, m0), _mm256_and_si256(b0, _mm256_xor_si256(t0, m0)));
+        __m256i s1 = _mm256_xor_si256(t1, m1), s2 = _mm256_xor_si256(b1, c0);
+        __m256i y1 = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(t1, m1), _mm256_and_si256(b1, c0)), _mm256_and_si256(s1, s2));
+        __m256i res = _mm256_andnot_si256(y1, _mm256_and_si256(_mm256_xor_si256(s1, s2), _mm256_or_si256(x0, cm)));
+        _mm256_storeu_si256((__m256i*)(dst + i), res);
+    }
+    stepColumnSSE2(dst + i, west + i, center + i, east + i, n - i);
+}
+#endif
+
+/* the best kernel level supported by both the CPU and the OS */
+inline int probeKernel() {
+#ifdef GLK_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool sse2 = info[3] & (1 << 26);
+    bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;   //OSXSAVE, AVX, YMM state
+    __cpuidex(info, 7, 0);
+    bool avx2 = avx && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return (avx2) ? GLK_AVX2 : (sse2) ? GLK_SSE2 : GLK_SCALAR;
+#else
+    return GLK_SCALAR;
+#endif
+}
+
+inline int detectKernel() {
+    static const int level = probeKernel();
+    return level;
+}
+
+inline GLRowKernel rowKernel(int level, bool conway = true) {
+#ifdef GLK_X86
+    switch (level) {
+    case GLK_AVX2: return (conway) ? stepRowAVX2<false> : stepRowAVX2<true>;
+    case GLK_SSE2: return (conway) ? stepRowSSE2<false> : stepRowSSE2<true>;
+    }
+#endif
+    return (conway) ? stepRowScalar<false> : stepRowScalar<true>;
+}
+
+inline GLRowCount rowCount(int level) {
+#ifdef GLK_X86
+    switch (level) {
+    case GLK_AVX2: return countRowAVX2;
+    case GLK_SSE2: return countRowSSE2;
+    }
+#endif
+    return countRowScalar;
+}
+
+inline GLRowPack rowPack(int level) {
+#ifdef GLK_X86
+    switch (level) {
+    case GLK_AVX2: return packRowAVX2;
+    case GLK_SSE2: return packRowSSE2;
+    }
+#endif
+    return packRowScalar;
+}
+
+inline GLColumnKernel columnKernel(int level) {
+#ifdef GLK_X86
+    switch (level) {
+    case GLK_AVX2: return stepColumnAVX2;
+    case GLK_SSE2: return stepColumnSSE2;
+    }
+#endif
+    return stepColumnScalar;
+}
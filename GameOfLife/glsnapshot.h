@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "glmap.h"
+#include "glbitmap.h"
+
+
+#define GLS_MAGIC       "GLSNAP01"
+#define GLS_MAGICSIZE   8
+#define GLS_HEADSIZE    40
+#define GLS_BOUNDLESS   0x01        //flag of the map mode
+#define GLS_BUFSIZE     (1 << 20)   //bytes buffered before writing to the stream
+
+
+/* binary snapshot of a map, all fields little endian:
+ * the header is the magic GLSNAP01, the width, height and generation as uint64,
+ * birth and survive as uint16, then the flags as uint32,
+ * the cells follow bit-packed as in GLBitMap, ceil(width / 64) words per row,
+ * and the words of all rows are run-length encoded as blocks of
+ * <varint zero words> <varint literal words> <literal words>
+ */
+struct GLSnapshot {
+    size_t width, height, gen;
+    bool boundless;
+    GLRule rule;
+};
+
+/* up to 64 cells as a word, bit i is cells[i] */
+inline uint64_t packWord(const bool cells[], size_t len) {
+    uint64_t word = 0;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {  //gathers bit 0 of the 8 bytes into the top byte
+        uint64_t bytes;
+        memcpy(&bytes, cells + i, 8);
+        word |= ((bytes * 0x0102040810204080ULL) >> 56) << i;
+    }
+    for (; i < len; i++) word |= uint64_t(cells[i]) << i;
+    return word;
+}
+
+inline void unpackWord(uint64_t word, size_t len, bool cells[]) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {  //spreads 8 bits to the lowest bit of 8 bytes
+        uint64_t bytes = (((word >> i) & 0xFF) * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+        bytes = ((bytes + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+        memcpy(cells + i, &bytes, 8);
+    }
+    for (; i < len; i++) cells[i] = (word >> i) & 1;
+}
+
+/* words(y, dst) fills dst with the ceil(width / 64) words of row y, the padding bits zero */
+template<class Words>
+bool writeSnapshot(std::ostream& out, const GLSnapshot& snap, Words words) {
+    std::vector<char> buf;
+    buf.reserve(GLS_BUFSIZE + GLS_HEADSIZE);
+    auto put = [&buf](uint64_t val, size_t bytes) { for (size_t i = 0; i < bytes; i++, val >>= 8) buf.push_back(char(val & 0xFF)); };
+    auto varint = [&buf](uint64_t val) {
+        for (; val >= 0x80; val >>= 7) buf.push_back(char(val | 0x80));
+        buf.push_back(char(val));
+    };
+
+    buf.insert(buf.end(), GLS_MAGIC, GLS_MAGIC + GLS_MAGICSIZE);
+    put(snap.width, 8);
+    put(snap.height, 8);
+    put(snap.gen, 8);
+    put(snap.rule.birth, 2);
+    put(snap.rule.survive, 2);
+    put((snap.boundless) ? GLS_BOUNDLESS : 0, 4);
+
+    size_t nwords = (snap.width + GLB_WORDBITS - 1) / GLB_WORDBITS;
+    std::vector<uint64_t> row(nwords), lits;
+    uint64_t zeros = 0;
+    auto block = [&]() {
+        varint(zeros);
+        varint(lits.size());
+        const char* data = (const char*)lits.data();   //the words are little endian as in memory
+        buf.insert(buf.end(), data, data + sizeof(uint64_t) * lits.size());
+        zeros = 0;
+        lits.clear();
+    };
+    for (size_t y = 0; y < snap.height; y++) {
+        words(y, row.data());
+        for (uint64_t word : row) {
+            if (word) lits.push_back(word);
+            else if (lits.empty()) zeros++;
+            else block(), zeros = 1;
+        }
+        if (buf.size() + sizeof(uint64_t) * lits.size() >= GLS_BUFSIZE) {
+            if (!lits.empty()) block();     //a long literal block is split at the end of a row
+            out.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    }
+    if (zeros || !lits.empty()) block();
+    out.write(buf.data(), buf.size());
+    return bool(out.flush());
+}
+
+inline bool saveSnapshot(std::ostream& out, const GLMap& map, bool boundless) {
+    GLSnapshot snap = { map.width(), map.height(), map.gen(), boundless, map.rule() };
+    return writeSnapshot(out, snap, [&map](size_t y, uint64_t* dst) {
+        for (size_t x = 0; x < map.width(); x += GLB_WORDBITS)
+            *dst++ = packWord(map[y] + x, std::min<size_t>(GLB_WORDBITS, map.width() - x));
+    });
+}
+
+inline bool saveSnapshot(std::ostream& out, const GLBitMap& map, bool boundless) {
+    GLSnapshot snap = { map.width(), map.height(), map.gen(), boundless, map.rule() };
+    return writeSnapshot(out, snap, [&map](size_t y, uint64_t* dst) { memcpy(dst, map.row(y), sizeof(uint64_t) * map.words()); });
+}
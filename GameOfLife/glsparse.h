@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <random>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "glmap.h"
+#include "glbitmap.h"
+
+
+#define GLS_TILESIZE    GLB_WORDBITS    //a tile is 64 rows of one word
+
+
+/* a tile of 64x64 cells, bit i of rows[y] is the cell at x = i */
+struct GLSTile {
+    uint64_t front[GLS_TILESIZE], back[GLS_TILESIZE];
+};
+
+/* sparse map on an unbounded plane:
+ * only the tiles holding alive cells are stored, tiles are allocated when a pattern
+ * grows into them and freed when they die out, so memory scales with the population,
+ * the window [0, width) x [0, height) given at construction is where init() places
+ * cells, and the boundless flag is ignored, rules with B0 are not supported since
+ * they would fill the whole plane
+ */
+class GLSparseMap {
+public:
+    GLSparseMap(size_t width, size_t height) :_width(width), _height(height), _gen(0) {}
+    GLSparseMap(const GLSparseMap&) = delete;
+    GLSparseMap(GLSparseMap&&) = delete;
+
+    size_t width() const { return _width; }
+    size_t height() const { return _height; }
+    size_t gen() const { return _gen; }
+    void gen(size_t gen) { _gen = gen; }
+    bool valid(size_t x, size_t y) const { return (x < _width && y < _height); }
+    size_t population() const;
+    bool bounds(GLRect& rect) const;
+    size_t threads() const { return 1; }
+    size_t tiles() const { return _tiles.size(); }
+    const GLRule& rule() const { return _rule; }
+    void rule(const GLRule& rule) { _rule = rule; }
+
+    bool get(long x, long y) const;
+    void set(long x, long y, bool alive);
+    void window(long left, long top, size_t width, size_t height, bool cells[]) const;
+
+    void init();
+    void init(float ratio, unsigned seed = std::minstd_rand::default_seed);
+    void init(const bool map[], size_t size);
+    void init(const GLPoint coord[], size_t size);
+    void init(const GLRect rect[], size_t size);
+    void next(bool boundless = false);     //the plane is unbounded, neither mode applies
+
+private:
+    size_t _width, _height, _gen;
+    std::unordered_map<uint64_t, std::unique_ptr<GLSTile>> _tiles;
+    GLRule _rule = GLR_CONWAY;
+
+    static long _tile(long pos) { return (pos >= 0) ? pos / GLS_TILESIZE : (pos + 1) / long(GLS_TILESIZE) - 1; }
+    static uint64_t _key(long tx, long ty) { return (uint64_t(uint32_t(ty)) << 32) | uint32_t(tx); }
+    static long _tx(uint64_t key) { return int32_t(uint32_t(key)); }
+    static long _ty(uint64_t key) { return int32_t(uint32_t(key >> 32)); }
+
+    const uint64_t* _front(long tx, long ty) const;
+    void _step(uint64_t key, GLSTile& tile) const;
+};
+
+inline size_t GLSparseMap::population() const {
+    size_t cnt = 0;
+    for (auto& kv : _tiles)
+        for (uint64_t word : kv.second->front) cnt += popcount64(word);
+    return cnt;
+}
+
+/* the smallest rectangle containing all alive cells, false if there is none */
+inline bool GLSparseMap::bounds(GLRect& rect) const {
+    rect = { LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN };
+    for (auto& kv : _tiles) {
+        long left = _tx(kv.first) * GLS_TILESIZE, top = _ty(kv.first) * GLS_TILESIZE;
+        for (long y = 0; y < GLS_TILESIZE; y++) {
+            uint64_t word = kv.second->front[y];
+            if (!word) continue;
+            rect.left = std::min(rect.left, left + long(ctz64(word)));
+            rect.right = std::max(rect.right, left + GLS_TILESIZE - long(clz64(word)));
+            rect.top = std::min(rect.top, top + y);
+            rect.bottom = std::max(rect.bottom, top + y + 1);
+        }
+    }
+    return rect.left < rect.right;
+}
+
+inline bool GLSparseMap::get(long x, long y) const {
+    const uint64_t* rows = _front(_tile(x), _tile(y));
+    return (rows[y - _tile(y) * GLS_TILESIZE] >> (x - _tile(x) * GLS_TILESIZE)) & 1;
+}
+
+inline void GLSparseMap::set(long x, long y, bool alive) {
+    uint64_t key = _key(_tile(x), _tile(y));
+    auto it = _tiles.find(key);
+    if (it == _tiles.end()) {
+        if (!alive) return;
+        it = _tiles.emplace(key, std::unique_ptr<GLSTile>(new GLSTile{})).first;
+    }
+    uint64_t& word = it->second->front[y - _tile(y) * GLS_TILESIZE];
+    uint64_t bit = uint64_t(1) << (x - _tile(x) * GLS_TILESIZE);
+    word = (alive) ? (word | bit) : (word & ~bit);
+}
+
+/* cells of the window [left, left + width) x [top, top + height), row by row */
+inline void GLSparseMap::window(long left, long top, size_t width, size_t height, bool cells[]) const {
+    std::fill(cells, cells + width * height, false);
+    for (auto& kv : _tiles) {
+        long tleft = _tx(kv.first) * GLS_TILESIZE, ttop = _ty(kv.first) * GLS_TILESIZE;
+        long x0 = std::max(tleft, left), x1 = std::min(tleft + GLS_TILESIZE, left + long(width));
+        long y0 = std::max(ttop, top), y1 = std::min(ttop + GLS_TILESIZE, top + long(height));
+        for (long y = y0; y < y1; y++) {
+            uint64_t word = kv.second->front[y - ttop];
+            for (long x = x0; word && x < x1; x++) cells[(y - top) * width + (x - left)] = (word >> (x - tleft)) & 1;
+        }
+    }
+}
+
+inline void GLSparseMap::init() {
+    _gen = 0;
+    _tiles.clear();
+}
+
+inline void GLSparseMap::init(float ratio, unsigned seed /*std::minstd_rand::default_seed*/) {
+    GLSoup soup(ratio, seed);   //the same soup as GLMap
+    std::vector<char> cells(_width * _height);
+    for (size_t y = 0; y < _height; y++) soup.row(y, (bool*)cells.data() + y * _width, _width);
+    init((bool*)cells.data(), cells.size());
+}
+
+inline void GLSparseMap::init(const bool map[], size_t size) {
+    init();
+    for (size_t i = 0; i < std::min(size, _width * _height); i++) {
+        if (map[i]) set(i % _width, i / _width, true);
+    }
+}
+
+inline void GLSparseMap::init(const GLPoint coord[], size_t size) {
+    init();
+    for (size_t i = 0; i < size; i++) {
+        auto& pt = coord[i];
+        if (valid(pt.x, pt.y)) set(pt.x, pt.y, true);
+    }
+}
+
+inline void GLSparseMap::init(const GLRect rect[], size_t size) {
+    init();
+    for (size_t i = 0; i < size; i++) {
+        long left = std::max(rect[i].left, 0L), right = std::min(rect[i].right, (long)_width);
+        long top = std::max(rect[i].top, 0L), bottom = std::min(rect[i].bottom, (long)_height);
+        for (long row = top; row < bottom; row++)
+            for (long col = left; col < right; col++) set(col, row, true);
+    }
+}
+
+inline const uint64_t* GLSparseMap::_front(long tx, long ty) const {
+    static const uint64_t zero[GLS_TILESIZE] = {};  //missing tiles are dead
+    auto it = _tiles.find(_key(tx, ty));
+    return (it != _tiles.end()) ? it->second->front : zero;
+}
+
+/* the back rows of a tile from the front rows of itself and its eight neighbours */
+inline void GLSparseMap::_step(uint64_t key, GLSTile& tile) const {
+    long tx = _tx(key), ty = _ty(key);
+    bool conway = _rule.conway();
+    const uint64_t* rows[3][3];     //[dy][dx] of the neighbour tiles
+    for (int dy = 0; dy < 3; dy++)
+        for (int dx = 0; dx < 3; dx++)
+            rows[dy][dx] = (dx == 1 && dy == 1) ? tile.front : _front(tx + dx - 1, ty + dy - 1);
+
+    for (long y = 0; y < GLS_TILESIZE; y++) {
+        uint64_t west[3], center[3], east[3];
+        for (int r = 0; r < 3; r++) {
+            long ny = y + r - 1;
+            int dy = (ny < 0) ? 0 : (ny < GLS_TILESIZE) ? 1 : 2;
+            ny = (ny + GLS_TILESIZE) % GLS_TILESIZE;
+            center[r] = rows[dy][1][ny];
+            west[r] = (center[r] << 1) | (rows[dy][0][ny] >> (GLS_TILESIZE - 1));
+            east[r] = (center[r] >> 1) | (rows[dy][2][ny] << (GLS_TILESIZE - 1));
+        }
+        tile.back[y] = (conway) ? stepWord(west, center, east) : stepWord(west, center, east, _rule);
+    }
+}
+
+/* the tiles next to alive edge cells are allocated before stepping,
+ * and the tiles without alive cells are freed after
+ */
+inline void GLSparseMap::next(bool /*boundless false*/) {
+    std::vector<uint64_t> grown;
+    for (auto& kv : _tiles) {
+        const uint64_t* rows = kv.second->front;
+        uint64_t cols = 0;
+        for (long y = 0; y < GLS_TILESIZE; y++) cols |= rows[y];
+        bool edge[3][3] = {     //[dy][dx], alive cells next to the neighbour
+            { bool(rows[0] & 1), rows[0] != 0, bool(rows[0] >> (GLS_TILESIZE - 1)) },
+            { bool(cols & 1), false, bool(cols >> (GLS_TILESIZE - 1)) },
+            { bool(rows[GLS_TILESIZE - 1] & 1), rows[GLS_TILESIZE - 1] != 0, bool(rows[GLS_TILESIZE - 1] >> (GLS_TILESIZE - 1)) },
+        };
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = 0; dx < 3; dx++) {
+                uint64_t key = _key(_tx(kv.first) + dx - 1, _ty(kv.first) + dy - 1);
+                if (edge[dy][dx] && !_tiles.count(key)) grown.push_back(key);
+            }
+        }
+    }
+    for (uint64_t key : grown) _tiles.emplace(key, std::unique_ptr<GLSTile>(new GLSTile{}));
+
+    for (auto& kv : _tiles) _step(kv.first, *kv.second);
+    for (auto it = _tiles.begin(); it != _tiles.end();) {
+        GLSTile& tile = *it->second;
+        memcpy(tile.front, tile.back, sizeof(tile.front));
+        bool alive = std::any_of(tile.front, tile.front + GLS_TILESIZE, [](uint64_t word) { return word != 0; });
+        it = (alive) ? std::next(it) : _tiles.erase(it);
+    }
+    _gen++;
+}
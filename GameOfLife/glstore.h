@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#endif
+
+
+/* read-write memory mapping of a temporary file, deleted once closed:
+ * the file starts sparse and dead, prefetch() asks for a range to be read ahead,
+ * flush() starts writing a range back without waiting, and release() waits for
+ * the range to be written and drops it from the page cache, so a pass over the
+ * whole mapping in order keeps only a few ranges in memory
+ */
+class GLStore {
+public:
+    GLStore() = default;
+    GLStore(const GLStore&) = delete;
+    GLStore(GLStore&&) = delete;
+    ~GLStore() { close(); }
+
+    bool* data() const { return _data; }
+    size_t size() const { return _size; }
+
+    bool open(const std::string& dir, size_t size);
+    void close();
+    void zero();
+    void prefetch(size_t offset, size_t len) const;
+    void flush(size_t offset, size_t len) const;
+    void release(size_t offset, size_t len) const;
+
+private:
+    bool* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+#else
+    int _fd = -1;
+#endif
+    static size_t _page() {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+        return page;
+#endif
+    }
+};
+
+#ifdef _WIN32
+inline bool GLStore::open(const std::string& dir, size_t size) {
+    close();
+    char fname[MAX_PATH];
+    if (!GetTempFileNameA(dir.c_str(), "glm", 0, fname)) return false;
+    _file = CreateFileA(fname, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) return DeleteFileA(fname), false;
+    size = (size > 0) ? size : 1;
+    HANDLE mapping = CreateFileMappingA(_file, nullptr, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size & 0xFFFFFFFF), nullptr);
+    _data = (mapping) ? (bool*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : nullptr;
+    if (mapping) CloseHandle(mapping);  //the view keeps the mapping alive
+    if (!_data) return close(), false;
+    _size = size;
+    return true;
+}
+
+inline void GLStore::close() {
+    if (_data) UnmapViewOfFile(_data);
+    if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+    _data = nullptr;
+    _size = 0;
+    _file = INVALID_HANDLE_VALUE;
+}
+
+inline void GLStore::zero() { memset(_data, 0, _size); }
+
+inline void GLStore::prefetch(size_t offset, size_t len) const {
+    if (offset >= _size) return;
+    size_t begin = offset / _page() * _page(), end = std::min(offset + len, _size);
+    WIN32_MEMORY_RANGE_ENTRY range = { _data + begin, end - begin };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+inline void GLStore::flush(size_t offset, size_t len) const {
+    if (offset < _size) FlushViewOfFile(_data + offset, std::min(len, _size - offset));
+}
+
+/* unlocking pages that are not locked takes them out of the working set, so once
+ * written they are the first to leave memory
+ */
+inline void GLStore::release(size_t offset, size_t len) const {
+    if (offset >= _size) return;
+    len = std::min(len, _size - offset);
+    FlushViewOfFile(_data + offset, len);
+    size_t begin = (offset + _page() - 1) / _page() * _page(), end = (offset + len) / _page() * _page();
+    if (begin < end) VirtualUnlock(_data + begin, end - begin);     //fails as not locked, after trimming them
+}
+#else
+/* the file is unlinked at once and lives as long as the descriptor */
+inline bool GLStore::open(const std::string& dir, size_t size) {
+    close();
+    std::string fname = dir + "/glmap.XXXXXX";
+    _fd = mkstemp(&fname[0]);
+    if (_fd < 0) return false;
+    unlink(fname.c_str());
+    size = (size > 0) ? size : 1;
+    void* data = (ftruncate(_fd, off_t(size)) == 0) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0) : MAP_FAILED;
+    if (data == MAP_FAILED) return close(), false;
+    _data = (bool*)data;
+    _size = size;
+    return true;
+}
+
+inline void GLStore::close() {
+    if (_data) munmap(_data, _size);
+    if (_fd >= 0) ::close(_fd);
+    _data = nullptr;
+    _size = 0;
+    _fd = -1;
+}
+
+/* cut to nothing and extended again, so the pages are dropped instead of written */
+inline void GLStore::zero() {
+    if (ftruncate(_fd, 0) != 0 || ftruncate(_fd, off_t(_size)) != 0) memset(_data, 0, _size);
+}
+
+inline void GLStore::prefetch(size_t offset, size_t len) const {
+    if (offset >= _size) return;
+    size_t begin = offset / _page() * _page(), end = std::min(offset + len, _size);
+    posix_madvise(_data + begin, end - begin, POSIX_MADV_WILLNEED);
+}
+
+inline void GLStore::flush(size_t offset, size_t len) const {
+    if (offset >= _size) return;
+#ifdef __linux__
+    sync_file_range(_fd, off_t(offset), off_t(std::min(len, _size - offset)), SYNC_FILE_RANGE_WRITE);
+#else
+    size_t begin = offset / _page() * _page(), end = std::min(offset + len, _size);
+    msync(_data + begin, end - begin, MS_ASYNC);
+#endif
+}
+
+inline void GLStore::release(size_t offset, size_t len) const {
+    if (offset >= _size) return;
+    len = std::min(len, _size - offset);
+#ifdef __linux__
+    sync_file_range(_fd, off_t(offset), off_t(len), SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    size_t begin = (offset + _page() - 1) / _page() * _page(), end = (offset + len) / _page() * _page();
+    if (begin < end) madvise(_data + begin, end - begin, MADV_DONTNEED);    //the pages still mapped are not dropped
+#endif
+    posix_fadvise(_fd, off_t(offset), off_t(len), POSIX_FADV_DONTNEED);
+}
+#endif
@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2023, Game of Life by Gee Wang
+ * Licensed under the GNU GPL v3.
+ * C++14 standard is required.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstring>
+
+#include "glmap.h"
+#include "glhistory.h"
+#include "glmipmap.h"
+
+
+#define GLTB_INDEX      3u
+#define GLTB_FRESH      4u
+
+#define GLWK_PAUSED     -1      //no generations but the requested ones
+#define GLWK_MAXSPEED   0       //no waiting between generations
+#define GLWK_BATCHTIME  2       //ms of generations between two frames at full speed
+#define GLWK_MARGIN     64      //cells published around the view, so that a small scroll is covered at once
+
+
+/* lock-free triple buffer with a single writer and a single reader:
+ * the writer fills back() and publishes it, the reader picks up the latest
+ * published slot with update(), neither of them ever waits for the other
+ */
+template<class T>
+class GLTripleBuffer {
+public:
+    T& back() { return _slots[_back]; }
+    const T& front() const { return _slots[_front]; }
+    void publish() { _back = _mid.exchange(_back | GLTB_FRESH, std::memory_order_acq_rel) & GLTB_INDEX; }
+    bool update();
+
+private:
+    T _slots[3];
+    std::atomic<unsigned> _mid{ 1 };    //slot index in the middle, with the fresh flag
+    unsigned _back = 0, _front = 2;
+};
+
+template<class T>
+bool GLTripleBuffer<T>::update() {
+    if (!(_mid.load(std::memory_order_relaxed) & GLTB_FRESH)) return false;
+    _front = _mid.exchange(_front, std::memory_order_acq_rel) & GLTB_INDEX;
+    return true;
+}
+
+/* a generation as the reader needs it, never the whole map:
+ * the cells of the view only, row by row, and the mipmap of the map while it is
+ * requested, a copy of the one of the worker brought up to date block by block
+ */
+struct GLFrame {
+    size_t width = 0, height = 0, gen = 0;
+    size_t period = 0;      //of the cycle found by the map, 0 for none
+    GLStats stats;          //of the generation if the map tallies
+    GLRect view = {};       //of the cells copied, inside the map
+    std::vector<char> cells;    //std::vector<bool> is not an array
+    GLMipmap mipmap;        //empty unless requested
+
+    bool covers(const GLRect& rect) const {
+        return rect.left >= view.left && rect.top >= view.top && rect.right <= view.right && rect.bottom <= view.bottom;
+    }
+    const char* row(size_t y, size_t x) const { return &cells[(y - view.top) * (view.right - view.left) + (x - view.left)]; }    //inside the view
+    bool operator()(size_t x, size_t y) const { return *row(y, x); }
+};
+
+/* steps a map on a dedicated thread:
+ * completed generations are published as frames through a triple buffer, and all
+ * changes of the map are queued to the worker, so the map itself must not be
+ * touched by other threads while the worker exists,
+ * with a history every generation and every change is recorded, and the map can
+ * be rewound to the generations still retained, the history also belongs to the worker,
+ * a frame only holds the view the reader asked for, so publishing costs the view
+ * and not the map, and while a mipmap is requested the worker updates its own from
+ * the tiles of the map, switched on for it, and copies only the blocks changed
+ * since the frame last held it, so the reader never waits for the worker, nor the
+ * worker for the reader
+ */
+class GLWorker {
+public:
+    explicit GLWorker(GLMap& map, GLHistory* history = nullptr);
+    GLWorker(const GLWorker&) = delete;
+    GLWorker(GLWorker&&) = delete;
+    ~GLWorker();
+
+    bool update() { return _frames.update(); }
+    const GLFrame& frame() const { return _frames.front(); }
+
+    void pace(int interval);
+    void boundless(bool boundless);
+    void step(size_t gens);
+    void edit(size_t x, size_t y, bool alive);
+    void clear();
+    void rewind(size_t gens);
+    void mipmap(bool enable);
+    void view(const GLRect& rect);
+    template<class Fn>
+    void readMap(Fn fn);
+
+private:
+    struct Edit { size_t x, y; bool alive; };
+
+    GLMap& _map;
+    GLHistory* _history;
+    GLTripleBuffer<GLFrame> _frames;
+    GLMipmap _mipmap;               //of the map, copied into the frames
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::vector<Edit> _edits;
+    int _interval = GLWK_PAUSED;    //ms between two generations
+    size_t _pending = 0;            //requested generations
+    size_t _rewind = 0;             //generations to go back
+    bool _boundless = false, _clear = false, _quit = false;
+    bool _mipped = false, _mipping = false;     //requested, and kept by the worker
+    GLRect _view = {};              //cells published, with the margin
+    bool _reframe = false;          //the view changed since the last frame
+    std::mutex _mapmtx;             //held by the worker while it changes the map
+    std::thread _thread;
+
+    void _publish(const GLRect& view, bool mipping);
+    void _work();
+};
+
+inline GLWorker::GLWorker(GLMap& map, GLHistory* history /*nullptr*/) :_map(map), _history(history) {
+    if (_history) _history->record(_map);
+    _publish(_view, false);
+    _frames.update();
+    _thread = std::thread(&GLWorker::_work, this);
+}
+
+inline GLWorker::~GLWorker() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _quit = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+}
+
+/* GLWK_PAUSED, GLWK_MAXSPEED, or the ms between two generations */
+inline void GLWorker::pace(int interval) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _interval = interval;
+    }
+    _cv.notify_one();
+}
+
+inline void GLWorker::boundless(bool boundless) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _boundless = boundless;
+}
+
+/* run extra generations at full speed, even if paused */
+inline void GLWorker::step(size_t gens) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _pending += gens;
+    }
+    _cv.notify_one();
+}
+
+inline void GLWorker::edit(size_t x, size_t y, bool alive) {
+    if (!_map.valid(x, y)) return;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _edits.push_back({ x, y, alive });
+    }
+    _cv.notify_one();
+}
+
+inline void GLWorker::clear() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _clear = true;
+        _edits.clear();
+    }
+    _cv.notify_one();
+}
+
+/* back to the oldest generation retained at most, nothing without a history */
+inline void GLWorker::rewind(size_t gens) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _rewind += gens;
+    }
+    _cv.notify_one();
+}
+
+/* the mipmap is released when no longer requested */
+inline void GLWorker::mipmap(bool enable) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _mipped = enable;
+    }
+    _cv.notify_one();
+}
+
+/* the cells of the rect are in every frame published from now on, the frame is
+ * published again at once unless they are already in it, and the view is narrowed
+ * again when it became much larger than needed, e.g. after zooming in
+ */
+inline void GLWorker::view(const GLRect& rect) {
+    GLRect wide = {};
+    if (rect.left < rect.right && rect.top < rect.bottom) {
+        wide.left = std::max(rect.left - GLWK_MARGIN, 0L), wide.top = std::max(rect.top - GLWK_MARGIN, 0L);
+        wide.right = std::min(rect.right + GLWK_MARGIN, long(_map.width())), wide.bottom = std::min(rect.bottom + GLWK_MARGIN, long(_map.height()));
+    }
+    auto area = [](const GLRect& r) { return (r.right - r.left) * (r.bottom - r.top); };
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        bool covered = rect.left >= _view.left && rect.top >= _view.top && rect.right <= _view.right && rect.bottom <= _view.bottom;
+        if ((covered || area(wide) == 0) && area(_view) <= 2 * area(wide)) return;
+        _view = wide;
+        _reframe = true;
+    }
+    _cv.notify_one();
+}
+
+/* the whole map for the rare reads that need it, such as a snapshot, waiting for
+ * the generations in progress, and holding the worker until fn returns
+ */
+template<class Fn>
+void GLWorker::readMap(Fn fn) {
+    std::lock_guard<std::mutex> lock(_mapmtx);
+    const GLMap& map = _map;
+    fn(map);
+}
+
+inline void GLWorker::_publish(const GLRect& view, bool mipping) {
+    GLFrame& frame = _frames.back();
+    frame.width = _map.width();
+    frame.height = _map.height();
+    frame.gen = _map.gen();
+    frame.period = _map.period();
+    frame.stats = _map.stats();
+    frame.view = view;
+    size_t cols = size_t(view.right - view.left);
+    frame.cells.resize(cols * size_t(view.bottom - view.top));
+    for (long y = view.top; y < view.bottom; y++)
+        memcpy(&frame.cells[size_t(y - view.top) * cols], _map[y] + view.left, sizeof(bool) * cols);
+    if (mipping && !_map.tiles()) _map.tiles(true);
+    if (mipping) _mipmap.update(_map);
+    else if (_mipmap.width()) _mipmap.clear();
+    frame.mipmap.copy(_mipmap);
+    _frames.publish();
+}
+
+/* the queued changes are applied between generations, and at full speed the
+ * generations are batched so that a frame is published every few ms
+ */
+inline void GLWorker::_work() {
+    using clock = std::chrono::steady_clock;
+    auto due = clock::now();
+    size_t batch = 1;
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (!_quit) {
+        size_t rewind = (_history) ? _rewind : 0;
+        bool edited = _clear || !_edits.empty(), dirty = edited || rewind;
+        bool remip = _mipped != _mipping, reframe = _reframe;
+        _mipping = _mipped;
+        _reframe = false;
+        if (edited) {
+            std::lock_guard<std::mutex> maplock(_mapmtx);
+            if (_clear) _map.init();
+            for (auto& e : _edits) {
+                _map[e.y][e.x] = e.alive;
+                _map.touch(e.x, e.y);
+            }
+        }
+        _clear = false;
+        _edits.clear();
+        _rewind = 0;
+
+        size_t gens = 0;
+        bool full = true;
+        auto now = clock::now();
+        if (_pending > 0) {
+            gens = std::min(_pending, batch);
+            _pending -= gens;
+        } else if (_interval == GLWK_MAXSPEED) {
+            gens = batch;
+        } else if (_interval > 0 && now >= due) {
+            gens = 1;
+            full = false;
+            due = std::max(due + std::chrono::milliseconds(_interval), now);
+        }
+
+        if (gens == 0 && !dirty && !remip && !reframe) {
+            if (_interval > 0) _cv.wait_until(lock, due);
+            else _cv.wait(lock);
+            continue;
+        }
+
+        bool boundless = _boundless, mipping = _mipping;
+        GLRect view = _view;
+        lock.unlock();
+        std::unique_lock<std::mutex> maplock(_mapmtx);
+        if (rewind && !_history->empty()) {
+            size_t first = _history->first(), gen = _map.gen();
+            _history->rewind((gen > first + rewind) ? gen - rewind : first, _map);
+        }
+        if (dirty && _map.tally()) _map.tally(true);    //the edits are not counted by next()
+        if (edited && _history) _history->record(_map); //replaces the generation edited
+        if (!_history) _map.next(boundless, gens);
+        for (size_t g = 0; _history && g < gens; g++) {
+            size_t gen = _map.gen();
+            _map.next(boundless, 1);
+            if (_map.gen() == gen) break;   //stopped by a cycle
+            _history->record(_map);
+        }
+        if (full && gens == batch) {
+            auto elapsed = clock::now() - now;
+            if (elapsed < std::chrono::milliseconds(GLWK_BATCHTIME)) batch *= 2;
+            else if (elapsed > std::chrono::milliseconds(GLWK_BATCHTIME * 4) && batch > 1) batch /= 2;
+        }
+        _publish(view, mipping);
+        maplock.unlock();
+        lock.lock();
+    }
+}